@@ -0,0 +1,340 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+// Throughput benchmark of canonical chains built from the library blocks. Each chain is fed by a
+// synthetic signal source and ends in a null sink (or a ZMQ publisher) so the results are the cost
+// of the blocks in between. The results can be printed as a table, CSV or JSON so they can be
+// collected and compared between releases.
+//
+// Usage: radiomon-bench [-h] [-f text|csv|json] [-o file] [-t ms] [-b block size] [-c chain name]
+//
+// The results go to stdout unless a file is given. Some blocks trace to stdout so use a file when
+// the results are parsed.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <cmath>
+#include <vector>
+#include <memory>
+
+#include "chain.h"
+#include "timer.h"
+#include "profiler.h"
+#include "cmdline.h"
+#include "aligned-ptr.h"
+
+#include "signal-source.h"
+#include "null-sink.h"
+#include "firfilt.h"
+#include "firdecim.h"
+#include "rational-resampler.h"
+#include "carrier-sync.h"
+#include "zmq-sample-pub.h"
+
+#ifndef RADIOMON_VERSION
+#define RADIOMON_VERSION "unknown"
+#endif
+
+constexpr dsp::rate_t Fs = 48000;
+constexpr dsp::rate_t F = 1200;
+
+// Prototype low pass filters, windowed sinc with a Blackman window
+constexpr size_t FIR_TAPS = 64;
+constexpr uint16_t DECIM_M = 4;
+constexpr uint16_t RESAMP_L = 3;
+constexpr uint16_t RESAMP_M = 4;
+constexpr size_t RESAMP_TAPS = 24;
+
+// Iterations run before timing so the buffers are sized and the caches warm
+constexpr uint32_t WARMUP = 16;
+
+enum out_format
+{
+    FORMAT_TEXT,
+    FORMAT_CSV,
+    FORMAT_JSON
+};
+
+struct bench_result
+{
+    const char *name;
+    size_t blockSize;
+    uint64_t iterations;
+    uint64_t samples;
+    uint64_t ns;
+    uint64_t allocs;
+    util::profile_stats iter;
+
+    double msps() const { return ns ? (samples * 1.0e3) / ns : 0.0; }
+    double nsPerSample() const { return samples ? static_cast<double>(ns) / samples : 0.0; }
+    double allocsPerIteration() const { return iterations ? static_cast<double>(allocs) / iterations : 0.0; }
+};
+
+// Adds the links of a benchmark to an empty chain.
+using bench_builder = void(util::chain &c, const size_t blockSize);
+
+struct bench
+{
+    const char *name;
+    bench_builder *build;
+};
+
+static std::vector<float> lowPass(const size_t taps, const float cutoff)
+{
+    std::vector<float> h(taps);
+    const float mid = (taps - 1) / 2.0f;
+    float sum = 0.0f;
+
+    for (size_t i=0;i < taps;i++)
+    {
+        float n = i - mid;
+        float sinc = (n == 0.0f) ? 2.0f * cutoff : std::sin(2.0f * M_PI * cutoff * n) / (M_PI * n);
+        float w = 0.42f - 0.5f * std::cos(2.0f * M_PI * i / (taps - 1)) + 0.08f * std::cos(4.0f * M_PI * i / (taps - 1));
+
+        h[i] = sinc * w;
+        sum += h[i];
+    }
+
+    for (auto &t : h)
+        t /= sum;
+
+    return h;
+}
+
+// Split a prototype filter into *rows* polyphase sub-filters.
+static std::vector<std::vector<float>> polyphase(const std::vector<float> &h, const size_t rows)
+{
+    std::vector<std::vector<float>> bank(rows);
+
+    for (size_t i=0;i < h.size();i++)
+        bank[i % rows].push_back(h[i]);
+
+    return bank;
+}
+
+static void buildFir(util::chain &c, const size_t blockSize)
+{
+    c.add(std::make_unique<dsp::endpoints::signal_source_ff>(blockSize, F, Fs), "SIG_SOURCE");
+    c.add(std::make_unique<dsp::firfilter_ff>(lowPass(FIR_TAPS, 0.1f)), "FIR");
+    c.add(std::make_unique<dsp::endpoints::null_ff>(), "NULL");
+}
+
+static void buildDecim(util::chain &c, const size_t blockSize)
+{
+    c.add(std::make_unique<dsp::endpoints::signal_source_ff>(blockSize, F, Fs), "SIG_SOURCE");
+    c.add(std::make_unique<dsp::firdecim_ff>(DECIM_M, lowPass(FIR_TAPS, 0.5f / DECIM_M)), "DECIM");
+    c.add(std::make_unique<dsp::endpoints::null_ff>(), "NULL");
+}
+
+static void buildResampler(util::chain &c, const size_t blockSize)
+{
+    auto bank = polyphase(lowPass(RESAMP_L * RESAMP_TAPS, 0.5f / RESAMP_M), RESAMP_L);
+
+    c.add(std::make_unique<dsp::endpoints::signal_source_ff>(blockSize, F, Fs), "SIG_SOURCE");
+    c.add(std::make_unique<dsp::rational_resampler_ff>(RESAMP_L, RESAMP_M, bank, RESAMP_L), "RESAMPLER");
+    c.add(std::make_unique<dsp::endpoints::null_ff>(), "NULL");
+}
+
+static void buildCarrierSync(util::chain &c, const size_t blockSize)
+{
+    c.add(std::make_unique<dsp::endpoints::signal_source_cc>(blockSize, F, Fs), "SIG_SOURCE");
+    c.add(std::make_unique<dsp::carrier_sync>(0.062831853f, 0.031415927f), "CARRIER_SYNC");
+    c.add(std::make_unique<dsp::endpoints::null_cc>(), "NULL");
+}
+
+static void buildZmqPub(util::chain &c, const size_t blockSize)
+{
+    c.add(std::make_unique<dsp::endpoints::signal_source_cc>(blockSize, F, Fs), "SIG_SOURCE");
+    c.add(std::make_unique<dsp::zmq_sample_pub_cc_snk>("radiomon-bench", "SAMPLES"), "ZMQ_PUB");
+}
+
+static const bench benches[] =
+{
+    { "fir",            buildFir },
+    { "decim",          buildDecim },
+    { "resampler",      buildResampler },
+    { "carrier-sync",   buildCarrierSync },
+    { "zmq-pub",        buildZmqPub }
+};
+
+// Iterate the chain for about *ms* milliseconds after warming up.
+static bool runBench(const bench &b, const size_t blockSize, const uint32_t ms, bench_result &r)
+{
+    util::chain c { b.name };
+
+    b.build(c, blockSize);
+
+    if (!c.setup())
+        return false;
+
+    for (uint32_t i=0;i < WARMUP;i++)
+        c.iterate();
+
+    util::profiler<true> iter;
+
+    r.name = b.name;
+    r.blockSize = blockSize;
+    r.iterations = 0;
+
+    auto allocs = util::aligned_ptr_allocs();
+    auto start = util::timer::StartTimer();
+
+    do
+    {
+        // Check the clock every few iterations so reading it doesn't skew small blocks.
+        for (uint32_t i=0;i < 16;i++)
+        {
+            auto mark = iter.start();
+            c.iterate();
+            iter.stop(mark, 0, 0);
+        }
+
+        r.iterations += 16;
+    }
+    while(util::timer::EndTimer(start) < ms);
+
+    r.ns = util::timer::EndTimerNs(start);
+    r.allocs = util::aligned_ptr_allocs() - allocs;
+    r.samples = r.iterations * blockSize;
+    iter.get(r.iter);
+
+    return true;
+}
+
+static void printResults(FILE *f, const std::vector<bench_result> &results, const out_format fmt)
+{
+    switch(fmt)
+    {
+        case FORMAT_TEXT:
+            fprintf(f, "radiomon-bench %s\n\n", RADIOMON_VERSION);
+            fprintf(f, "%-14s %6s %10s %10s %10s %12s %12s %10s\n",
+                    "chain", "block", "iters", "MSps", "ns/sample", "iter p50 ns", "iter p99 ns", "allocs/it");
+
+            for (auto &r : results)
+            {
+                fprintf(f, "%-14s %6lu %10lu %10.2f %10.2f %12lu %12lu %10.3f\n",
+                        r.name, r.blockSize, r.iterations, r.msps(), r.nsPerSample(),
+                        r.iter.p50Ns, r.iter.p99Ns, r.allocsPerIteration());
+            }
+            break;
+
+        case FORMAT_CSV:
+            fprintf(f, "version,chain,block_size,iterations,samples,ns,msps,ns_per_sample,iter_p50_ns,iter_p99_ns,iter_max_ns,allocs_per_iteration\n");
+
+            for (auto &r : results)
+            {
+                fprintf(f, "%s,%s,%lu,%lu,%lu,%lu,%.3f,%.3f,%lu,%lu,%lu,%.3f\n",
+                        RADIOMON_VERSION, r.name, r.blockSize, r.iterations, r.samples, r.ns, r.msps(),
+                        r.nsPerSample(), r.iter.p50Ns, r.iter.p99Ns, r.iter.maxNs, r.allocsPerIteration());
+            }
+            break;
+
+        case FORMAT_JSON:
+            fprintf(f, "{\n  \"version\": \"%s\",\n  \"results\": [\n", RADIOMON_VERSION);
+
+            for (size_t i=0;i < results.size();i++)
+            {
+                auto &r = results[i];
+
+                fprintf(f, "    { \"chain\": \"%s\", \"block_size\": %lu, \"iterations\": %lu, \"samples\": %lu, \"ns\": %lu, "
+                        "\"msps\": %.3f, \"ns_per_sample\": %.3f, \"iter_p50_ns\": %lu, \"iter_p99_ns\": %lu, "
+                        "\"iter_max_ns\": %lu, \"allocs_per_iteration\": %.3f }%s\n",
+                        r.name, r.blockSize, r.iterations, r.samples, r.ns, r.msps(), r.nsPerSample(),
+                        r.iter.p50Ns, r.iter.p99Ns, r.iter.maxNs, r.allocsPerIteration(),
+                        (i + 1 < results.size()) ? "," : "");
+            }
+
+            fprintf(f, "  ]\n}\n");
+            break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    out_format fmt = FORMAT_TEXT;
+    uint32_t ms = 1000;
+    size_t blockSize = 4096;
+    const char *only = nullptr;
+
+    if (util::cmdOptionExists(argv, argv + argc, "-h"))
+    {
+        printf("Usage: radiomon-bench [-h] [-f text|csv|json] [-o file] [-t ms] [-b block size] [-c chain name]\n"
+                "  -h   Print this and exit.\n"
+                "  -f   The format of the results; text by default.\n"
+                "  -o   Write the results to a file instead of stdout.\n"
+                "  -t   Run each chain for this many milliseconds; 1000 by default.\n"
+                "  -b   The number of samples per source block; 4096 by default.\n"
+                "  -c   Only run the chain with this name.\n");
+        return 0;
+    }
+
+#ifndef __OPTIMIZE__
+    // The meson build always optimizes it; this catches a hand built one.
+    fprintf(stderr, "radiomon-bench was built without optimization; the results aren't representative\n");
+#endif
+
+    char *opt = util::getCmdOption(argv, argv + argc, "-f");
+
+    if (opt)
+    {
+        if (!strcmp(opt, "csv"))
+            fmt = FORMAT_CSV;
+        else if (!strcmp(opt, "json"))
+            fmt = FORMAT_JSON;
+        else if (strcmp(opt, "text"))
+        {
+            fprintf(stderr, "Unknown format %s\n", opt);
+            return -1;
+        }
+    }
+
+    if ((opt = util::getCmdOption(argv, argv + argc, "-t")))
+        ms = static_cast<uint32_t>(atoi(opt));
+
+    if ((opt = util::getCmdOption(argv, argv + argc, "-b")))
+        blockSize = static_cast<size_t>(atoi(opt));
+
+    only = util::getCmdOption(argv, argv + argc, "-c");
+    opt = util::getCmdOption(argv, argv + argc, "-o");
+
+    FILE *f = opt ? fopen(opt, "w") : stdout;
+
+    if (!f)
+    {
+        fprintf(stderr, "Can't open %s\n", opt);
+        return -1;
+    }
+
+    if (!blockSize)
+    {
+        fprintf(stderr, "The block size must be greater than zero\n");
+        return -1;
+    }
+
+    std::vector<bench_result> results;
+
+    for (auto &b : benches)
+    {
+        if (only && strcmp(only, b.name))
+            continue;
+
+        bench_result r;
+
+        if (!runBench(b, blockSize, ms, r))
+        {
+            fprintf(stderr, "Chain %s setup failed\n", b.name);
+            return -1;
+        }
+
+        results.push_back(r);
+    }
+
+    printResults(f, results, fmt);
+
+    if (f != stdout)
+        fclose(f);
+
+    return 0;
+}
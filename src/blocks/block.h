@@ -6,9 +6,13 @@
 
 #include <functional>
 #include <type_traits>
+#include <cassert>
 
 #include "aligned-ptr.h"
+#include "workspace.h"
 #include "rm-math.h"
+#include "timer.h"
+#include "stream-tag.h"
 
 namespace dsp {
 
@@ -44,6 +48,27 @@ using func_fc = void(const util::aligned_ptr<float>&, util::aligned_ptr<rm_math:
 using func_cc = void(const util::aligned_ptr<rm_math::complex_f>&, util::aligned_ptr<rm_math::complex_f>&);
 using func_cf = void(const util::aligned_ptr<rm_math::complex_f>&, util::aligned_ptr<float>&);
 
+//! \cond
+//////////////////////////
+// The sample types going in and out of each block function type.
+template<typename>
+struct block_io;
+
+template<>
+struct block_io<func_ff> { using in_type = float; using out_type = float; };
+
+template<>
+struct block_io<func_fc> { using in_type = float; using out_type = rm_math::complex_f; };
+
+template<>
+struct block_io<func_cc> { using in_type = rm_math::complex_f; using out_type = rm_math::complex_f; };
+
+template<>
+struct block_io<func_cf> { using in_type = rm_math::complex_f; using out_type = float; };
+
+//! \endcond
+//////////////////////////
+
 using rate_t = uint32_t;
 
 enum block_type
@@ -69,8 +94,14 @@ class block
 {
 public:
 
+    //! The block function type (e.g., *func_ff*).
+    using func_type = T;
+
+    //! The span function type of element-wise blocks, see *isElementwise()*.
+    using kernel_type = void(const typename block_io<T>::in_type *in, typename block_io<T>::out_type *out, size_t n);
+
     //! Get the block's processing method.
-    auto        getProcesser() const { return process; }
+    const std::function<T>& getProcesser() const { return process; }
 
     //! Set the current sampling rate for the block to use.
     void        setSamplingRate(uint32_t rate) { m_SamplingRate = rate; }
@@ -84,10 +115,105 @@ public:
     //! Set the mode for a bidirectional block.
     void        setBidirMode(bidir_mode mode) { m_BidirMode = mode; }
 
+    //! Get the largest block a source (or a bidirectional block in source mode) outputs.
+    //! Zero means it's not known, e.g., the block hasn't been configured yet.
+    size_t      getMaxSourceSize() const { return m_MaxSourceSize; }
+
+    //! Get the largest block the block outputs given the largest block it will be given. Resamplers
+    //! scale it by their rate ratio and allow for one extra sample carried over from a previous call.
+    size_t      getMaxOutputSize(const size_t maxIn) const
+    {
+        if ((m_RateL == 1) && (m_RateM == 1))
+            return maxIn;
+
+        return (maxIn * m_RateL + m_RateM - 1) / m_RateM + 1;
+    }
+
+    //! Check if the block can process in place, i.e., it can be given the same buffer as its input
+    //! and output. Only blocks with the same input and output type can do this.
+    bool        isInPlace() const { return m_InPlace; }
+
+    //! Check if the block is element-wise, i.e., each output sample only depends on the input sample
+    //! at the same index (and on state updated in sample order). Such blocks can process any span of
+    //! a block on its own with *getKernel()* which lets a chain run several of them in one pass.
+    bool        isElementwise() const { return static_cast<bool>(kernel); }
+
+    //! Get the span function of an element-wise block. The span may be processed in place.
+    const std::function<kernel_type>& getKernel() const { return kernel; }
+
+    //! Give the block the tags of the block it's about to process. This is called by the chain
+    //! before each call.
+    void        setTags(tag_list *tags) { m_Tags = tags; }
+
+    //! Get the tags of the block being processed. Blocks may read them while processing; a block
+    //! which isn't run by a *util::chain* has none.
+    const tag_list& getTags() const
+    {
+        static const tag_list none;
+        return m_Tags ? *m_Tags : none;
+    }
+
+    //! Get the offset of the output sample which corresponds to an input sample of the block just
+    //! processed. For a resampler it's the first output at or after the input once its filter delay
+    //! is allowed for, which depends on the phase it was in at the start of the block. The offset can
+    //! be past the end of the output, e.g., when the block didn't complete an output sample.
+    size_t      getOutputOffset(const size_t inOffset) const
+    {
+        const int64_t pos = static_cast<int64_t>(inOffset) * m_RateL + m_GroupDelay - m_OutputPhase;
+
+        return (pos > 0) ? static_cast<size_t>((pos + m_RateM - 1) / m_RateM) : 0;
+    }
+
+    //! Get the absolute index at the output rate of an absolute input sample index. Resamplers scale
+    //! it by their rate ratio.
+    uint64_t    getOutputIndex(const uint64_t inIndex) const
+    {
+        return (inIndex * m_RateL) / m_RateM;
+    }
+
+    //! Get the time the last block output by a source was captured, if the source knows it, e.g.,
+    //! an endpoint which reads from a device on a thread of its own. Chains use it to measure latency.
+    //! The time is cleared once read so a source which stops setting it doesn't report a stale one.
+    //! @param [out] t  The capture time.
+    //! @return **true** if the source set a capture time for the last block, **false** otherwise.
+    bool        getCaptureTime(util::timer::timer_t &t)
+    {
+        const bool has = m_HasCaptureTime;
+
+        if (has)
+            t = m_CaptureTime;
+
+        m_HasCaptureTime = false;
+        return has;
+    }
+
+    //! Tell the block the largest block it will be given so it can size any internal buffers it
+    //! needs before processing starts. This is called by the chain during setup.
+    void        setMaxInputSize(const size_t maxIn)
+    {
+        if (reserve)
+            reserve(maxIn);
+    }
+
+    //! Get the scratch space, in bytes, the block needs while processing a block of up to *maxIn*
+    //! samples. The chain sizes the workspace it passes with *setWorkspace()* from this.
+    size_t      getScratchSize(const size_t maxIn) const
+    {
+        return scratch ? scratch(maxIn) : 0;
+    }
+
+    //! Give the block the workspace to take its temporaries from while processing the next block.
+    //! This is called by the chain before each call; the memory is shared by every link the calling
+    //! thread runs so nothing in it survives the call.
+    void        setWorkspace(util::workspace *ws) { m_Workspace = ws; }
+
 protected:
     //! \cond
 
-    block(block_type type) : m_SamplingRate { 0 },  m_BidirMode { BIDIR_NONE }, m_Type { type }
+    block(block_type type) : m_SamplingRate { 0 },  m_BidirMode { BIDIR_NONE },
+                                m_MaxSourceSize { 0 }, m_RateL { 1 }, m_RateM { 1 },
+                                m_GroupDelay { 0 }, m_OutputPhase { 0 }, m_InPlace { false }, m_HasCaptureTime { false },
+                                m_Tags { nullptr }, m_Workspace { nullptr }, m_Type { type }
     { }
 
     block() = delete;
@@ -100,14 +226,113 @@ protected:
 
     std::function<T> process;
 
+    // Optional; blocks with internal buffers which depend on the input size bind this to
+    // size them up front. See setMaxInputSize().
+    std::function<void(size_t)> reserve;
+
+    // Optional; blocks which need temporaries while processing bind this to give the bytes of
+    // scratch they need for an input of up to the given size. See getWorkspace().
+    std::function<size_t(size_t)> scratch;
+
+    // Optional; element-wise blocks bind this to process *n* samples from *in* to *out*, which
+    // may be the same. See isElementwise().
+    std::function<kernel_type> kernel;
+
+    // Sizing hints used by the chain to plan its buffers
+    void setMaxSourceSize(const size_t size) { m_MaxSourceSize = size; }
+    void setRateRatio(const uint16_t L, const uint16_t M) { m_RateL = L; m_RateM = M; }
+
+    // Resamplers keep these up to date for getOutputOffset(). Both are in samples at **L** times the
+    // input rate: the delay of the filter, and the position of the first output of the current call
+    // relative to its first input, which they set at the start of each call.
+    void setGroupDelay(const size_t delay) { m_GroupDelay = static_cast<uint32_t>(delay); }
+    void setOutputPhase(const int64_t phase) { m_OutputPhase = phase; }
+
+    // Blocks which never read an input sample after writing the output sample at the same index
+    // can set this so the chain passes them a single buffer for both.
+    void setInPlace(const bool inPlace)
+    {
+        assert(!inPlace || (std::is_same<typename block_io<T>::in_type, typename block_io<T>::out_type>::value));
+        m_InPlace = inPlace;
+    }
+
+    // Sources which know when their samples were captured set this with each block. See getCaptureTime().
+    void setCaptureTime(const util::timer::timer_t &t)
+    {
+        m_CaptureTime = t;
+        m_HasCaptureTime = true;
+    }
+
+    // Sources attach tags to the block they output with this. The offset is from the start of
+    // the output block. Returns false if the tag was dropped because the block has no room for it.
+    bool addTag(const stream_tag &tag)
+    {
+        if (!m_Tags || (m_Tags->size() == m_Tags->capacity()))
+            return false;
+
+        m_Tags->push_back(tag);
+        return true;
+    }
+
+    // Get an empty workspace holding at least the scratch declared for an input of *n* samples. It's
+    // the one the chain passed if that's big enough, otherwise memory of the block's own, e.g., when
+    // the block isn't run by a chain.
+    util::workspace& getWorkspace(const size_t n)
+    {
+        const size_t bytes = getScratchSize(n);
+
+        if (m_Workspace && (m_Workspace->size() >= bytes))
+        {
+            m_Workspace->reset();
+            return *m_Workspace;
+        }
+
+        return m_Scratch.get(bytes);
+    }
+
     rate_t m_SamplingRate;
 
     bidir_mode m_BidirMode;
 
+    size_t m_MaxSourceSize;
+    uint16_t m_RateL;
+    uint16_t m_RateM;
+    uint32_t m_GroupDelay;
+    int64_t m_OutputPhase;
+
+    bool m_InPlace;
+
+    util::timer::timer_t m_CaptureTime;
+    bool m_HasCaptureTime;
+
+    tag_list *m_Tags;
+
+    util::workspace *m_Workspace;
+    util::scratch_buffer m_Scratch;
+
 private:
     block_type  m_Type;
 
     //! \endcond
 };
 
+/*! \brief Direct Access to a Block's Processing Method
+ *
+ * This is used by *util::static_chain* to call the processing method of a block directly rather
+ * than through the *std::function* returned by *getProcesser()* so the compiler can inline across
+ * links. Each block specializes this for its own type at the bottom of its header. Blocks which
+ * don't fall back to the *std::function*.
+ */
+
+template<typename Blk>
+struct processor
+{
+    //! Process a block of samples.
+    template<typename U, typename V>
+    static void call(Blk &blk, const util::aligned_ptr<U> &in, util::aligned_ptr<V> &out)
+    {
+        blk.getProcesser()(in, out);
+    }
+};
+
 }
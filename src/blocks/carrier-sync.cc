@@ -16,13 +16,21 @@ carrier_sync::carrier_sync(const float Kp, const float Ki, const size_t errorPor
                             m_ErrorPort { errorPortSize }
 {
     block<func_cc>::process = std::bind(&carrier_sync::sync, this, std::placeholders::_1, std::placeholders::_2);
+    block<func_cc>::scratch = &comps::freq_est::scratchSize;
+    block<func_cc>::setInPlace(true);
 
     // m_Tick = util::timer::StartTimer();
 }
 
 void carrier_sync::sync(const util::aligned_ptr<rm_math::complex_f> &inBlock, util::aligned_ptr<rm_math::complex_f> &outBlock)
 {
-    auto errorSig = util::make_aligned_ptr<float>(inBlock.size());
+    // The error signal is only needed if someone is listening on the port. Each block sent
+    // is handed over to the port so it can't be reused.
+    util::aligned_ptr<float> errorSig;
+    const bool sendError = (m_ErrorPort.maxSize() > 0);
+
+    if (sendError)
+        util::init_aligned_ptr<float>(errorSig, inBlock.size());
 
     util::init_aligned_ptr_on_resize<rm_math::complex_f>(outBlock, inBlock.size());
 
@@ -35,22 +43,28 @@ void carrier_sync::sync(const util::aligned_ptr<rm_math::complex_f> &inBlock, ut
     }
 
     // Get the estimate and update the NCO
-    m_Nco.setFrequency(m_Est.estimate(inBlock));
+    m_Nco.setFrequency(m_Est.estimate(inBlock, getWorkspace(inBlock.size())));
 
     // PLL to fine tune the estimated frequency and also good for handling noisy channels
     for (size_t i = 0; i < inBlock.size(); i++)
     {
+        // Read the input first since the output may be the same buffer
+        auto sample = inBlock[i];
+
         // Get the sample adjusted by the error and store it in the
         // output buffer
         outBlock[i] = m_Nco.adjustPhase(m_LoopFilt.filter(m_Error));
 
         // Calculate the new error
-        m_Error = rm_math::atan2(inBlock[i] * std::conj(outBlock[i]));
-        errorSig[i] = m_Error;
+        m_Error = rm_math::atan2(sample * std::conj(outBlock[i]));
+
+        if (sendError)
+            errorSig[i] = m_Error;
     }
 
     // Make the error signal available for testing
-    m_ErrorPort.produce(std::move(errorSig));
+    if (sendError)
+        m_ErrorPort.produce(std::move(errorSig));
 
 #if 0
     if (util::timer::EndTimer(m_Tick) > 1000)
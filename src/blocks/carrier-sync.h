@@ -40,6 +40,7 @@ public:
     //!                             error calculations of the PLL which and be used for
     //!                             testing and debugging. See the *port* documention for details.
     //!                             By default, this is set to zero which does not generate an error signal.
+    //!                             Each error block is allocated so leave it at zero in production chains.
     carrier_sync(const float Kp, const float Ki, const size_t errorPortSize = 0);
 
     //! Generate a sinusoid fragment from the input samples which is frequency and phase aligned with the
@@ -69,4 +70,16 @@ private:
     util::timer::timer_t m_Tick;
     FILE *m_TestFile;
 };
+
+//! \cond
+template<>
+struct processor<carrier_sync>
+{
+    static void call(carrier_sync &blk, const util::aligned_ptr<rm_math::complex_f> &in, util::aligned_ptr<rm_math::complex_f> &out)
+    {
+        blk.sync(in, out);
+    }
+};
+//! \endcond
+
 }
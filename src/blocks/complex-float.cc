@@ -9,12 +9,17 @@ using namespace dsp;
 complex_float::complex_float() : block<dsp::func_cf> { TYPE_OPERATOR }
 {
     block<dsp::func_cf>::process = std::bind(&complex_float::convert, this, std::placeholders::_1, std::placeholders::_2);
+    block<dsp::func_cf>::kernel = std::bind(&complex_float::convertSpan, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
 }
 
 void complex_float::convert(const util::aligned_ptr<rm_math::complex_f> &inBlock, util::aligned_ptr<float> &outBlock)
 {
     util::init_aligned_ptr_on_resize<float>(outBlock, inBlock.size());
+    convertSpan(inBlock.data(), &outBlock[0], inBlock.size());
+}
 
-    for (size_t i=0;i < inBlock.size();i++)
-        outBlock[i] = inBlock[i].real();
+void complex_float::convertSpan(const rm_math::complex_f *in, float *out, const size_t n)
+{
+    for (size_t i=0;i < n;i++)
+        out[i] = in[i].real();
 }
@@ -27,6 +27,23 @@ public:
     //! @param [in]  inBlock     The block of complex samples to convert.
     //! @param [out] outBlock    The block of real samples which will be the same size as *inBlock*.
     void convert(const util::aligned_ptr<rm_math::complex_f> &inBlock, util::aligned_ptr<float> &outBlock);
+
+    //! Convert a span of complex samples to real samples. This is the element-wise form of *convert()*.
+    //! @param [in]  in     The complex samples to convert.
+    //! @param [out] out    The real samples.
+    //! @param [in]  n      The number of samples.
+    void convertSpan(const rm_math::complex_f *in, float *out, const size_t n);
+};
+
+//! \cond
+template<>
+struct processor<complex_float>
+{
+    static void call(complex_float &blk, const util::aligned_ptr<rm_math::complex_f> &in, util::aligned_ptr<float> &out)
+    {
+        blk.convert(in, out);
+    }
 };
+//! \endcond
 
 }
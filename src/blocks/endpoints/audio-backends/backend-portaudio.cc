@@ -45,7 +45,7 @@ audio_ep *dsp::endpoints::make_audio_endpoint()
 
 #endif // AUDIO_ENDPOINT_STATIC
 
-pa_impl::pa_impl() : m_Stream { nullptr }, m_ThreadsActive { false }, m_BuffSz { 0 }
+pa_impl::pa_impl() : m_Stream { nullptr }, m_ThreadsActive { false }, m_BuffSz { 0 }, m_ReadCount { 0 }
 {
 #ifndef NDEBUG
     auto err = Pa_Initialize();
@@ -62,6 +62,13 @@ pa_impl::~pa_impl()
 {
     m_ThreadsActive = false;
 
+    // Release the threads if they're blocked on a ring buffer
+    if (m_ReadBuff)
+        m_ReadBuff->abort();
+
+    if (m_WriteBuff)
+        m_WriteBuff->abort();
+
     if (m_ReadTh.get())
         m_ReadTh->join();
 
@@ -156,6 +163,15 @@ void pa_impl::process_samples_impl(const util::aligned_ptr<float> &inBlock, util
     {
         util::init_aligned_ptr_on_resize<float>(outBlock, m_BlockSize);
         m_ReadBuff->read(&outBlock[0], outBlock.size());
+
+        // The newest sample of the block was read from the device before whatever is still
+        // buffered behind it, so date the block back from the last read by that much.
+        if (m_ReadCount.load(std::memory_order_acquire))
+        {
+            auto buffered = static_cast<uint64_t>(m_ReadBuff->amount());
+            setCaptureTime(util::timer::BeforeNs(m_ReadTime.load(std::memory_order_relaxed),
+                                                    (buffered * 1000000000ULL) / m_SamplingRate));
+        }
     }
     else
     {
@@ -165,16 +181,18 @@ void pa_impl::process_samples_impl(const util::aligned_ptr<float> &inBlock, util
 
 void pa_impl::writeThread(util::ring_buffer<float> &wBuff)
 {
-    auto buff = std::make_unique<float[]>(m_BlockSize);
-
     while(m_ThreadsActive)
     {
-        wBuff.read(&buff[0], m_BlockSize);
+        // Write straight from the ring buffer
+        auto buff = wBuff.acquireRead(m_BlockSize);
+        if (buff.empty()) break;
 
         m_IOMtx.lock();
-        auto res = Pa_WriteStream(m_Stream, static_cast<const void *>(buff.get()), m_BlockSize);
+        auto res = Pa_WriteStream(m_Stream, static_cast<const void *>(buff.data()), m_BlockSize);
         m_IOMtx.unlock();
 
+        wBuff.commitRead(m_BlockSize);
+
         std::lock_guard<std::mutex> lck(m_Mtx);
         if (res == paOutputUnderflowed)
             ++m_Stats.underflow;
@@ -185,15 +203,23 @@ void pa_impl::writeThread(util::ring_buffer<float> &wBuff)
 
 void pa_impl::readThread(util::ring_buffer<float> &rBuff)
 {
-    auto buff = std::make_unique<float[]>(m_BlockSize);
-
     while(m_ThreadsActive)
     {
+        // Read straight into the ring buffer
+        auto buff = rBuff.acquireWrite(m_BlockSize);
+        if (buff.empty()) break;
+
         m_IOMtx.lock();
-        auto res = Pa_ReadStream(m_Stream, static_cast<void *>(&buff[0]), m_BlockSize);
+        auto res = Pa_ReadStream(m_Stream, static_cast<void *>(buff.data()), m_BlockSize);
         m_IOMtx.unlock();
 
-        rBuff.write(buff.get(), m_BlockSize);
+        auto readTime = util::timer::StartTimer();
+
+        rBuff.commitWrite(m_BlockSize);
+
+        // The time the newest samples in the ring buffer came from the device; see process_samples_impl().
+        m_ReadTime.store(readTime, std::memory_order_relaxed);
+        m_ReadCount.fetch_add(1, std::memory_order_release);
 
         std::lock_guard<std::mutex> lck(m_Mtx);
         if (res == paInputOverflowed)
@@ -209,13 +235,18 @@ void pa_impl::setupThread(uint32_t size, bool in, bool out)
 
     if (in)
     {
-        m_ReadBuff = std::make_unique<util::ring_buffer<float>>(size);
+        m_ReadBuff = std::make_unique<util::ring_buffer<float>>(size, 1000, util::MEM_MIRRORED);
+        m_ReadBuff->setWaitMode(util::RB_WAIT_EVENT);
+
+        // A chain which falls behind loses its oldest samples rather than stalling the capture
+        m_ReadBuff->setFullPolicy(util::RB_FULL_OVERWRITE_OLDEST);
         m_ReadTh = std::make_unique<std::thread>(&pa_impl::readThread, this, std::ref(*m_ReadBuff));
     }
 
     if (out)
     {
-        m_WriteBuff = std::make_unique<util::ring_buffer<float>>(size);
+        m_WriteBuff = std::make_unique<util::ring_buffer<float>>(size, 1000, util::MEM_MIRRORED);
+        m_WriteBuff->setWaitMode(util::RB_WAIT_EVENT);
         m_WriteTh = std::make_unique<std::thread>(&pa_impl::writeThread, this, std::ref(*m_WriteBuff));
     }
 }
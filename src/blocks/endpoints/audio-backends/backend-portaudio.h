@@ -30,6 +30,9 @@ public:
     int start_stream_impl();
     void process_samples_impl(const util::aligned_ptr<float> &inBlock, util::aligned_ptr<float> &outBlock);
 
+    util::ring_buffer<float>* input_buffer_impl() { return m_ReadBuff.get(); }
+    util::ring_buffer<float>* output_buffer_impl() { return m_WriteBuff.get(); }
+
 private:
     std::vector<device_info> m_DevInfo;
 
@@ -49,6 +52,10 @@ private:
     std::mutex m_IOMtx;
     uint32_t m_BuffSz;
 
+    // The time of the last block read from the device and the number of blocks read
+    std::atomic<util::timer::timer_t> m_ReadTime;
+    std::atomic<uint64_t> m_ReadCount;
+
     PaStreamParameters m_InputParams;
     PaStreamParameters m_OutputParams;
 
@@ -13,6 +13,7 @@
 #include <array>
 #include <mutex>
 #include <thread>
+#include <atomic>
 
 #include "block.h"
 #include "trace.h"
@@ -147,6 +148,7 @@ public:
     {
         assert(rate && blkSz);
         m_SamplingRate = rate;
+        setMaxSourceSize(blkSz);
         return static_cast<T*>(this)->set_device_impl(devs, rate, blkSz, bufSz, data);
     }
 
@@ -179,6 +181,22 @@ public:
         static_cast<T*>(this)->process_samples_impl(inBlock, outBlock);
     }
 
+    //! Get the ring buffer between the hardware and the chain on the input side, if the backend
+    //! uses one. This can be watched by *util::chain::run()* to count overruns.
+    //! @return The ring buffer or *nullptr* if there isn't one or the stream hasn't been started.
+    util::ring_buffer<float>* input_buffer()
+    {
+        return static_cast<T*>(this)->input_buffer_impl();
+    }
+
+    //! Get the ring buffer between the chain and the hardware on the output side, if the backend
+    //! uses one. This can be watched by *util::chain::run()* to count underruns.
+    //! @return The ring buffer or *nullptr* if there isn't one or the stream hasn't been started.
+    util::ring_buffer<float>* output_buffer()
+    {
+        return static_cast<T*>(this)->output_buffer_impl();
+    }
+
     //! Get the current stream statistics
     //! @param [out]  state stream_stats structure
     void get_stats(stream_stats &stats)
@@ -245,3 +263,18 @@ std::unique_ptr<audio_ep> make_audio_endpoint();
 #endif // INCLUDE_AUDIO_ENDPOINTS
 
 }}
+
+namespace dsp {
+
+//! \cond
+template<typename T>
+struct processor<endpoints::audio<T>>
+{
+    static void call(endpoints::audio<T> &blk, const util::aligned_ptr<float> &in, util::aligned_ptr<float> &out)
+    {
+        blk.process_samples(in, out);
+    }
+};
+//! \endcond
+
+}
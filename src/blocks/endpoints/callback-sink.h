@@ -14,7 +14,8 @@ namespace dsp { namespace endpoints {
 /*! \brief Simple Callback Sink
  *
  * This endpoint simply takes the result of a chain's operators and passes it to
- * the supplied callback. It does no processing on the actual data.
+ * the supplied callback. It does no processing on the actual data. A callback which
+ * also takes a *tag_list* is given the tags of each block (see *stream_tag*).
  */
 
 template<typename T, typename B>
@@ -28,11 +29,20 @@ public:
     //! The callback method signature.
     using user_cb = void(const util::aligned_ptr<T> &data);
 
+    //! The callback method signature with the tags of the block.
+    using user_tag_cb = void(const util::aligned_ptr<T> &data, const tag_list &tags);
+
     //! Create an instance.
     //! @param [in] cb  The method to invoke when a chain iteration is complete.
-    callback_sink(user_cb cb) : block<B> { TYPE_SINK }
+    callback_sink(user_cb cb) : block<B> { TYPE_SINK }, m_CB { cb }, m_TagCB { nullptr }
+    {
+        block<B>::process = std::bind(&callback_sink::cb_wrapper, this, std::placeholders::_1, std::placeholders::_2);
+    }
+
+    //! Create an instance which passes on the tags of each block.
+    //! @param [in] cb  The method to invoke when a chain iteration is complete.
+    callback_sink(user_tag_cb cb) : block<B> { TYPE_SINK }, m_CB { nullptr }, m_TagCB { cb }
     {
-        m_CB = cb;
         block<B>::process = std::bind(&callback_sink::cb_wrapper, this, std::placeholders::_1, std::placeholders::_2);
     }
 
@@ -41,12 +51,16 @@ public:
     //! @param [out] outBlock    Ignored.
     void cb_wrapper(const util::aligned_ptr<T> &inBlock, util::aligned_ptr<T> &outBlock)
     {
-        m_CB(inBlock);
+        if (m_TagCB)
+            m_TagCB(inBlock, block<B>::getTags());
+        else
+            m_CB(inBlock);
     }
 
 private:
 
     user_cb *m_CB;
+    user_tag_cb *m_TagCB;
 
 };
 
@@ -54,3 +68,18 @@ using callback_ff = callback_sink<float, func_ff>;
 using callback_cc = callback_sink<rm_math::complex_f, func_cc>;
 
 }}
+
+namespace dsp {
+
+//! \cond
+template<typename T, typename B>
+struct processor<endpoints::callback_sink<T, B>>
+{
+    static void call(endpoints::callback_sink<T, B> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.cb_wrapper(in, out);
+    }
+};
+//! \endcond
+
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <type_traits>
+
+#include "block.h"
+
+namespace dsp { namespace endpoints {
+
+/*! \brief Null Sink
+ *
+ * This endpoint discards whatever reaches it. It's useful for benchmarking chains, where the sink
+ * should cost nothing, and for terminating chains whose results are taken elsewhere, e.g., by a tee.
+ */
+
+template<typename T, typename B>
+class null_sink : public block<B>
+{
+    static_assert((std::is_floating_point<T>::value == std::true_type()) || util::is_std_complex_v<T>);
+    static_assert(is_block_func_v<B>);
+
+public:
+
+    //! Create an instance.
+    null_sink() : block<B> { TYPE_SINK }
+    {
+        block<B>::process = std::bind(&null_sink::discard, this, std::placeholders::_1, std::placeholders::_2);
+    }
+
+    //! Discard a block.
+    //! @param [in]  inBlock     Ignored.
+    //! @param [out] outBlock    Ignored.
+    void discard(const util::aligned_ptr<T> &inBlock, util::aligned_ptr<T> &outBlock)
+    {
+    }
+};
+
+using null_ff = null_sink<float, func_ff>;
+using null_cc = null_sink<rm_math::complex_f, func_cc>;
+
+}}
+
+namespace dsp {
+
+//! \cond
+template<typename T, typename B>
+struct processor<endpoints::null_sink<T, B>>
+{
+    static void call(endpoints::null_sink<T, B> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.discard(in, out);
+    }
+};
+//! \endcond
+
+}
@@ -41,6 +41,8 @@ public:
                         m_Size { size }, m_SamplingRate { samplingRate }
     {
         block<B>::process = std::bind(&signal_source::generate, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::scratch = std::bind(&signal_source::scratchSize, this, std::placeholders::_1);
+        block<B>::setMaxSourceSize(size);
     }
 
     //! Generate a block of samples.
@@ -54,7 +56,7 @@ public:
         util::init_aligned_ptr_on_resize<T>(outBlock, m_Size);
 
         std::lock_guard<std::mutex> lck(m_Mtx);
-        m_Sine.get(outBlock);
+        m_Sine.get(outBlock, block<B>::getWorkspace(m_Size));
     }
 
     ///////////////////////////////////////////////////////////////////////////////////
@@ -88,9 +90,30 @@ private:
     rate_t m_SamplingRate;
 
     std::mutex m_Mtx;
+
+    // The block size is fixed so the input size doesn't matter.
+    size_t scratchSize(const size_t maxIn) const
+    {
+        return util::sine_source<T>::scratchSize(m_Size);
+    }
 };
 
 using signal_source_ff = signal_source<float, dsp::func_ff>;
 using signal_source_cc = signal_source<rm_math::complex_f, dsp::func_cc>;
 
 }}
+
+namespace dsp {
+
+//! \cond
+template<typename T, typename B>
+struct processor<endpoints::signal_source<T, B>>
+{
+    static void call(endpoints::signal_source<T, B> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.generate(in, out);
+    }
+};
+//! \endcond
+
+}
@@ -69,8 +69,16 @@ public:
     //! @param [in] outBlock  Ignored.
     void handler(const util::aligned_ptr<T> &inBlock, util::aligned_ptr<T> &outBlock)
     {
-        for (size_t i=0;i < inBlock.size();i++)
-            std::fprintf(m_File, "%0.6f ", inBlock[i]);
+        write(inBlock);
+    }
+
+    //! Print samples to the file from outside a chain, e.g., a *util::shared_block* which other
+    //! consumers hold as well. Nothing is copied.
+    //! @param [in] samples   The samples to print to a file
+    void write(util::aligned_span<const T> samples)
+    {
+        for (size_t i=0;i < samples.size();i++)
+            std::fprintf(m_File, "%0.6f ", samples[i]);
 
         std::fflush(m_File);
     }
@@ -112,18 +120,23 @@ public:
     }
 
     void handler(const util::aligned_ptr<rm_math::complex_f> &inBlock, util::aligned_ptr<rm_math::complex_f> &outBlock)
+    {
+        write(inBlock);
+    }
+
+    void write(util::aligned_span<const rm_math::complex_f> samples)
     {
         // In Octave/MatLab use this command to load a file with complex values
         // as generated by this function. Note the single quote at the end.
         // cell2mat(textscan(f, "%f"))'
-        for (size_t i=0;i < inBlock.size();i++)
+        for (size_t i=0;i < samples.size();i++)
         {
-            std::fprintf(m_File, "%0.6f", inBlock[i].real());
+            std::fprintf(m_File, "%0.6f", samples[i].real());
 
-            if (inBlock[i].imag() >= 0)
+            if (samples[i].imag() >= 0)
                 std::fprintf(m_File, "+");
 
-            std::fprintf(m_File, "%0.6f", inBlock[i].imag());
+            std::fprintf(m_File, "%0.6f", samples[i].imag());
         }
 
         std::fflush(m_File);
@@ -138,3 +151,18 @@ using text_file_sink_ff = text_file_sink<float, dsp::func_ff>;
 using text_file_sink_cc = text_file_sink<rm_math::complex_f, dsp::func_cc>;
 
 }}
+
+namespace dsp {
+
+//! \cond
+template<typename T, typename B>
+struct processor<endpoints::text_file_sink<T, B>>
+{
+    static void call(endpoints::text_file_sink<T, B> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.handler(in, out);
+    }
+};
+//! \endcond
+
+}
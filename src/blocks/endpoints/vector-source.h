@@ -8,6 +8,7 @@
 #include <vector>
 #include <array>
 #include <functional>
+#include <algorithm>
 
 #include "block.h"
 
@@ -31,21 +32,21 @@ public:
     //! Create a new instance.
     //! @param [in] data    The vector of samples to output.
     vector_source(const std::vector<T> &data, const rate_t rate) : block<B> { TYPE_SOURCE },
-                    m_Data { data }, m_SamplingRate { rate }
+                    m_Data { data }, m_Source { m_Data }, m_SamplingRate { rate }
     {
         block<B>::process = std::bind(&vector_source::generate, this, std::placeholders::_1, std::placeholders::_2);
-        m_Callback = std::bind(&vector_source::vectorHandler, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::setMaxSourceSize(m_Data.size());
     }
 
     //! Create a new instance.
     //! @param [in] data    The vector of samples to output.
-    vector_source(const std::array<T, R> &data, const rate_t rate) : block<B> { TYPE_SOURCE }, m_SamplingRate { rate }
+    vector_source(const std::array<T, R> &data, const rate_t rate) : block<B> { TYPE_SOURCE },
+                    m_Source { data }, m_SamplingRate { rate }
     {
         static_assert(R);
 
-        m_StaticData = &data;
         block<B>::process = std::bind(&vector_source::generate, this, std::placeholders::_1, std::placeholders::_2);
-        m_Callback = std::bind(&vector_source::arrayHandler, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::setMaxSourceSize(R);
     }
 
     //! Generate a block of samples.
@@ -55,31 +56,36 @@ public:
     {
         // Endpoint sources must set the sampling rate on each block processing call
         block<B>::m_SamplingRate = m_SamplingRate;
-        m_Callback(inBlock, outBlock);
+
+        util::init_aligned_ptr_on_resize<T>(outBlock, m_Source.size());
+        std::copy(m_Source.begin(), m_Source.end(), outBlock.begin());
     }
 
 private:
-    std::vector<T>          m_Data;
-    const std::array<T, R>  *m_StaticData;
+    std::vector<T> m_Data;
 
-    std::function<B> m_Callback;
+    // The samples output, either m_Data or the array given at construction
+    util::aligned_span<const T> m_Source;
 
     rate_t m_SamplingRate;
-
-    void vectorHandler(const util::aligned_ptr<T> &inBlock, util::aligned_ptr<T> &outBlock)
-    {
-        util::init_aligned_ptr_on_resize<T>(outBlock, m_Data.size());
-        std::copy(m_Data.begin(), m_Data.end(), outBlock.begin());
-    }
-
-    void arrayHandler(const util::aligned_ptr<T> &inBlock, util::aligned_ptr<T> &outBlock)
-    {
-        util::init_aligned_ptr_on_resize<T>(outBlock, m_StaticData->size());
-        std::copy(m_StaticData->begin(), m_StaticData->end(), outBlock.begin());
-    }
 };
 
 using vector_source_ff = vector_source<float, dsp::func_ff>;
 using vector_source_cc = vector_source<rm_math::complex_f, dsp::func_cc>;
 
 }}
+
+namespace dsp {
+
+//! \cond
+template<typename T, typename B, size_t R>
+struct processor<endpoints::vector_source<T, B, R>>
+{
+    static void call(endpoints::vector_source<T, B, R> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.generate(in, out);
+    }
+};
+//! \endcond
+
+}
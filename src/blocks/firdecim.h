@@ -34,35 +34,49 @@ public:
     //! Create an instance with a integer interpolation factor and FIR filter.
     //! @param [in] M       The integer decimation factor,
     //! @param [in] taps    The filter coefficients.
-    firdecim(const uint16_t M, const util::aligned_ptr<float> &taps) : block<B> { TYPE_RESAMPLER }, m_M { M }
+    firdecim(const uint16_t M, const util::aligned_ptr<float> &taps) : block<B> { TYPE_RESAMPLER }, m_M { M }, m_SamplingCount { 0 }
     {
         assert(M > 0);
 
         block<B>::process = std::bind(&firdecim::decim, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::reserve = std::bind(&firdecim::reserveBuffers, this, std::placeholders::_1);
+        block<B>::setRateRatio(1, M);
         m_LpFilter = std::make_unique<firfilter<T, B>>(taps);
     }
 
     //! Create an instance with a integer interpolation factor and FIR filter.
     //! @param [in] M       The integer decimation factor,
     //! @param [in] taps    The filter coefficients.
-    firdecim(const uint16_t M, const std::vector<float> &taps) : block<B> { TYPE_RESAMPLER }, m_M { M }
+    firdecim(const uint16_t M, const std::vector<float> &taps) : block<B> { TYPE_RESAMPLER }, m_M { M }, m_SamplingCount { 0 }
     {
         assert(M > 0);
 
         block<B>::process = std::bind(&firdecim::decim, this, std::placeholders::_1, std::placeholders::_2);
-        m_LpFilter = std::make_unique<firfilter<T, B>>(taps.data());
+        block<B>::reserve = std::bind(&firdecim::reserveBuffers, this, std::placeholders::_1);
+        block<B>::setRateRatio(1, M);
+        m_LpFilter = std::make_unique<firfilter<T, B>>(taps);
     }
 
     //! Create an instance with a integer interpolation factor and FIR filter.
     //! @param [in] M       The integer decimation factor,
     //! @param [in] taps    The filter coefficients.
     template<size_t S>
-    firdecim(const uint16_t M, const std::array<float, S> &taps) : block<B> { TYPE_RESAMPLER }, m_M { M }
+    firdecim(const uint16_t M, const std::array<float, S> &taps) : block<B> { TYPE_RESAMPLER }, m_M { M }, m_SamplingCount { 0 }
     {
         assert(M > 0);
 
         block<B>::process = std::bind(&firdecim::decim, this, std::placeholders::_1, std::placeholders::_2);
-        m_LpFilter = std::make_unique<firfilter<T, B>>(taps).data();
+        block<B>::reserve = std::bind(&firdecim::reserveBuffers, this, std::placeholders::_1);
+        block<B>::setRateRatio(1, M);
+        m_LpFilter = std::make_unique<firfilter<T, B>>(taps);
+    }
+
+    //! Replace the filter taps while the block is in use. See *firfilter::setTaps()*.
+    //! @param [in] taps    The filter coefficients.
+    template<typename C>
+    void setTaps(const C &taps)
+    {
+        m_LpFilter->setTaps(taps);
     }
 
     //! Decimate a block of a signal.
@@ -71,23 +85,19 @@ public:
     //!                             the size of *inBlock* / **M** + 1.
     void decim(const util::aligned_ptr<T> &inBlock, util::aligned_ptr<T> &outBlock)
     {
-        // If the sampling buffer is in an invalid state, validate it with the size of the
-        // current block + the decimation factor.
-        // Otherwise, check if it can hold the current block plus the current contents and,
-        // if not, re-allocate a larger buffer and continue.
-        if (m_SamplingBuffer.empty())
-            m_SamplingBuffer = util::make_aligned_ptr<T>(inBlock.size() + m_M);
-        else if ((inBlock.size() + m_SamplingCount) > m_SamplingBuffer.size())
-            m_SamplingBuffer = util::make_aligned_ptr<T>(inBlock.size() + m_SamplingCount + m_M, m_SamplingBuffer.data());
-
-        // Create the filter buffer and filter the current block
-        auto filterBlock = util::make_aligned_ptr<T>(inBlock.size());
-        m_LpFilter->filter(inBlock, filterBlock);
-
-        // Append the newly filtered data to the sampling buffer
-        size_t mod = m_SamplingCount % m_M;
-        std::copy(filterBlock.begin(), filterBlock.end(), m_SamplingBuffer.begin() + mod);
+        // Check if the sampling buffer can hold the current block plus the current contents and,
+        // if not, re-allocate a larger buffer and continue. This only happens if the block is
+        // larger than what was given to setMaxInputSize().
+        if ((inBlock.size() + m_SamplingCount) > m_SamplingBuffer.size())
+            growSamplingBuffer(inBlock.size() + m_SamplingCount + m_M);
+
+        // The first output is the oldest sample left in the sampling buffer
+        block<B>::setOutputPhase(-static_cast<int64_t>(m_SamplingCount));
+
+        // Filter the current block straight into the sampling buffer after the current contents
+        m_LpFilter->filter(inBlock, m_SamplingBuffer.subspan(m_SamplingCount, inBlock.size()));
         m_SamplingCount += inBlock.size();
+        block<B>::setGroupDelay((m_LpFilter->getNumTaps() - 1) / 2);
 
         // Create the output buffer
         util::init_aligned_ptr_on_resize<T>(outBlock, m_SamplingCount / m_M);
@@ -102,9 +112,8 @@ public:
             cnt += m_M;
         }
 
-        // Shift the remaining content in the sampling buffer for the next block
-        mod = m_SamplingCount % cnt;
-        std::move(m_SamplingBuffer.begin() + cnt, m_SamplingBuffer.begin() + cnt + mod, m_SamplingBuffer.begin());
+        // Shift the remaining content (less than M samples) in the sampling buffer for the next block
+        std::move(m_SamplingBuffer.begin() + cnt, m_SamplingBuffer.begin() + m_SamplingCount, m_SamplingBuffer.begin());
         m_SamplingCount -= cnt;
 
         // Resamplers must set the sampling rate on each block processing call
@@ -114,11 +123,37 @@ public:
 private:
 
     uint16_t m_M;
-    uint16_t m_SamplingCount;
+    size_t m_SamplingCount;
 
     std::unique_ptr<firfilter<T, B>> m_LpFilter;
     util::aligned_ptr<T> m_SamplingBuffer;
+
+    void reserveBuffers(const size_t maxIn)
+    {
+        if ((maxIn + m_M) > m_SamplingBuffer.size())
+            growSamplingBuffer(maxIn + m_M);
+    }
+
+    // Re-allocate the sampling buffer keeping the samples not yet sampled.
+    void growSamplingBuffer(const size_t size)
+    {
+        util::aligned_ptr<T> buff { size };
+
+        std::copy(m_SamplingBuffer.begin(), m_SamplingBuffer.begin() + m_SamplingCount, buff.begin());
+        m_SamplingBuffer = std::move(buff);
+    }
+};
+
+//! \cond
+template<typename T, typename B>
+struct processor<firdecim<T, B>>
+{
+    static void call(firdecim<T, B> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.decim(in, out);
+    }
 };
+//! \endcond
 
 using firdecim_ff = firdecim<float,dsp::func_ff>;
 using firdecim_cc = firdecim<rm_math::complex_f,dsp::func_cc>;
@@ -4,11 +4,13 @@
 
 #pragma once
 
+#include <cstring>
 #include <algorithm>
 #include <vector>
 #include <array>
 
 #include "block.h"
+#include "hot-swap.h"
 
 namespace dsp {
 
@@ -17,6 +19,8 @@ namespace dsp {
  * This provides support for filtering a signal through a finite impulse response
  * (FIR) filter. The signal can be real or complex but only real coefficients are supported.
  *
+ * The taps can be replaced with *setTaps()* while another thread is filtering. The new taps are
+ * picked up at the start of the next block without locking or allocating in the filter.
 */
 
 template<typename T, typename B>
@@ -30,17 +34,21 @@ public:
     //! @param [in] taps    An aligned_ptr of coefficents.
     firfilter(const util::aligned_ptr<float> &taps) : block<B> { TYPE_OPERATOR }, m_Taps { taps }
     {
-        block<B>::process = std::bind(&firfilter::filter, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::process = std::bind(static_cast<block_filter>(&firfilter::filter), this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::setInPlace(true);
         util::init_aligned_ptr<T>(m_State, m_Taps.size());
+        std::fill(m_State.begin(), m_State.end(), T { });
     }
 
     //! Create an instance for filtering.
     //! @param [in] taps    A vector of coefficents.
     firfilter(const std::vector<float> &taps) : block<B> { TYPE_OPERATOR }
     {
-        block<B>::process = std::bind(&firfilter::filter, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::process = std::bind(static_cast<block_filter>(&firfilter::filter), this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::setInPlace(true);
         util::init_aligned_ptr<float>(m_Taps, taps.size(), taps.data());
-        util::init_aligned_ptr<T>(m_Taps, taps.size());
+        util::init_aligned_ptr<T>(m_State, m_Taps.size());
+        std::fill(m_State.begin(), m_State.end(), T { });
     }
 
     //! Create an instance for filtering.
@@ -48,31 +56,113 @@ public:
     template<size_t S>
     firfilter(const std::array<float, S> &taps) : block<B> { TYPE_OPERATOR }
     {
-        block<B>::process = std::bind(&firfilter::filter, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::process = std::bind(static_cast<block_filter>(&firfilter::filter), this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::setInPlace(true);
         util::init_aligned_ptr<float>(m_Taps, taps.size(), taps.data());
-        util::init_aligned_ptr<T>(m_Taps, taps.size());
+        util::init_aligned_ptr<T>(m_State, m_Taps.size());
+        std::fill(m_State.begin(), m_State.end(), T { });
+    }
+
+    //! Replace the taps. This may be called from one thread while another thread filters. The new
+    //! taps are used from the next block on and the old ones are freed by the next call (or when the
+    //! filter is destroyed). The number of taps may change; the most recent samples are carried over.
+    //! @param [in] taps    An aligned_ptr of coefficents.
+    void setTaps(const util::aligned_ptr<float> &taps)
+    {
+        publishTaps(taps.data(), taps.size());
+    }
+
+    //! Replace the taps. See above.
+    //! @param [in] taps    A vector of coefficents.
+    void setTaps(const std::vector<float> &taps)
+    {
+        publishTaps(taps.data(), taps.size());
     }
 
+    //! Replace the taps. See above.
+    //! @param [in] taps    An array of coefficents.
+    template<size_t S>
+    void setTaps(const std::array<float, S> &taps)
+    {
+        publishTaps(taps.data(), taps.size());
+    }
+
+    //! Get the number of taps in use. Call it from the filtering thread since the taps are swapped there.
+    size_t getNumTaps() const { return m_Taps.size(); }
+
     //! Filter a segment of a signal.
     //! @param [in]  inBlock     The data to be filtered.
     //! @param [out] outBlock    The filtered data.
     void filter(const util::aligned_ptr<T> &inBlock, util::aligned_ptr<T> &outBlock)
     {
         util::init_aligned_ptr_on_resize<T>(outBlock, inBlock.size());
+        filter(util::aligned_span<const T> { inBlock }, util::aligned_span<T> { outBlock });
+    }
+
+    //! Filter a segment of a signal from one view into another, e.g., part of a larger buffer.
+    //! @param [in]  in     The data to be filtered.
+    //! @param [out] out    Where the filtered data goes; it must hold at least as many samples as *in*.
+    void filter(util::aligned_span<const T> in, util::aligned_span<T> out)
+    {
+        assert(out.size() >= in.size());
+
+        m_TapSwap.apply([this](tap_set &next) { swapTaps(next); });
 
-        for (size_t i=0;i < inBlock.size();i++)
+        for (size_t i=0;i < in.size();i++)
         {
             std::move_backward(m_State.begin(), m_State.end() - 1, m_State.end());
-            m_State[0] = inBlock[i];
-            rm_math::dot_prod(&outBlock[i], m_State.data(), m_Taps.data(), m_Taps.size());
+            m_State[0] = in[i];
+            rm_math::dot_prod(&out[i], m_State, m_Taps);
         }
     }
 
 private:
 
+    // The overload of filter() bound to the block
+    using block_filter = void (firfilter::*)(const util::aligned_ptr<T>&, util::aligned_ptr<T>&);
+
+    // A replacement set of taps and a delay line to go with them
+    struct tap_set
+    {
+        util::aligned_ptr<float> taps;
+        util::aligned_ptr<T> state;
+    };
+
     util::aligned_ptr<float> m_Taps;
     util::aligned_ptr<T> m_State;
+
+    util::hot_swap<tap_set> m_TapSwap;
+
+    void publishTaps(const float *taps, const size_t size)
+    {
+        auto next = std::make_unique<tap_set>();
+
+        util::init_aligned_ptr<float>(next->taps, size, taps);
+        util::init_aligned_ptr<T>(next->state, size);
+        std::fill(next->state.begin(), next->state.end(), T { });
+
+        m_TapSwap.publish(std::move(next));
+    }
+
+    // Called by the filtering thread; the old taps and state end up in *next*.
+    void swapTaps(tap_set &next)
+    {
+        std::memcpy(&next.state[0], m_State.data(), std::min(m_State.size(), next.state.size()) * sizeof(T));
+        std::swap(m_Taps, next.taps);
+        std::swap(m_State, next.state);
+    }
+};
+
+//! \cond
+template<typename T, typename B>
+struct processor<firfilter<T, B>>
+{
+    static void call(firfilter<T, B> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.filter(in, out);
+    }
 };
+//! \endcond
 
 using firfilter_ff = firfilter<float, dsp::func_ff>;
 using firfilter_cc = firfilter<rm_math::complex_f, dsp::func_cc>;
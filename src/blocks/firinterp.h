@@ -36,39 +36,29 @@ public:
     //! @param [in] taps    The filter coefficients.
     //! @param [in] adjustGain  Adjust the coeffcients by *L*. Defaults to *true*.
     firinterp(const uint16_t L, const util::aligned_ptr<float> &taps, const bool adjustGain = true) :
-                    block<B> { TYPE_RESAMPLER }, m_L { L }
+                    block<B> { TYPE_RESAMPLER }, m_L { L }, m_AdjustGain { adjustGain }
     {
         assert(L > 0);
 
         block<B>::process = std::bind(&firinterp::interp, this, std::placeholders::_1, std::placeholders::_2);
-
-        if (adjustGain)
-        {
-            for (auto it = taps.begin(); it != taps.end();++it)
-                *it *= L;
-        }
-
-        m_LpFilter = std::make_unique<firfilter<T, B>>(taps);
+        block<B>::scratch = std::bind(&firinterp::scratchSize, this, std::placeholders::_1);
+        block<B>::setRateRatio(L, 1);
+        makeFilter(taps.data(), taps.size());
     }
 
     //! Create an instance with a integer interpolation factor and FIR filter.
     //! @param [in] L       The integer interpolation factor
     //! @param [in] taps    The filter coefficients.
     //! @param [in] adjustGain  Adjust the coeffcients by *L*. Defaults to *true*.
-    firinterp(const uint16_t L, std::vector<float> &taps, const bool adjustGain = true) :
-                    block<B> { TYPE_RESAMPLER }, m_L { L }
+    firinterp(const uint16_t L, const std::vector<float> &taps, const bool adjustGain = true) :
+                    block<B> { TYPE_RESAMPLER }, m_L { L }, m_AdjustGain { adjustGain }
     {
         assert(L > 0);
 
         block<B>::process = std::bind(&firinterp::interp, this, std::placeholders::_1, std::placeholders::_2);
-
-        if (adjustGain)
-        {
-            for (auto it = taps.begin(); it != taps.end();++it)
-                *it *= L;
-        }
-
-        m_LpFilter = std::make_unique<firfilter<T, B>>(taps.data());
+        block<B>::scratch = std::bind(&firinterp::scratchSize, this, std::placeholders::_1);
+        block<B>::setRateRatio(L, 1);
+        makeFilter(taps.data(), taps.size());
     }
 
     //! Create an instance with a integer interpolation factor and FIR filter.
@@ -77,19 +67,23 @@ public:
     //! @param [in] adjustGain  Adjust the coeffcients by *L*. Defaults to *true*.
     template<size_t S>
     firinterp(const uint16_t L, const std::array<float, S> &taps, const bool adjustGain = true) :
-                    block<B> { TYPE_RESAMPLER }, m_L { L }
+                    block<B> { TYPE_RESAMPLER }, m_L { L }, m_AdjustGain { adjustGain }
     {
         assert(L > 0);
 
         block<B>::process = std::bind(&firinterp::interp, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::scratch = std::bind(&firinterp::scratchSize, this, std::placeholders::_1);
+        block<B>::setRateRatio(L, 1);
+        makeFilter(taps.data(), taps.size());
+    }
 
-        if (adjustGain)
-        {
-            for (auto it = taps.begin(); it != taps.end();++it)
-                *it *= L;
-        }
-
-        m_LpFilter = std::make_unique<firfilter<T, B>>(taps.data());
+    //! Replace the filter taps while the block is in use. See *firfilter::setTaps()*. The coefficients
+    //! are adjusted by **L** if that was requested at construction.
+    //! @param [in] taps    The filter coefficients.
+    template<typename C>
+    void setTaps(const C &taps)
+    {
+        m_LpFilter->setTaps(adjustTaps(taps.data(), taps.size()));
     }
 
     //! Interpolate a block of a signal.
@@ -99,12 +93,14 @@ public:
     {
         const size_t outBlockSize = inBlock.size() * m_L;
 
-        auto filterBlock = util::make_aligned_ptr<T>(outBlockSize);
-        util::init_aligned_ptr<T>(outBlock, outBlockSize);
+        // The zero stuffed input only lives for this call
+        auto stuffed = block<B>::getWorkspace(inBlock.size()).template get<T>(outBlockSize);
+
+        util::init_aligned_ptr_on_resize<T>(outBlock, outBlockSize);
 
         const uint16_t cnt = m_L - 1;
 
-        for (auto it=inBlock.begin(), jt=filterBlock.begin();it != inBlock.end();++it)
+        for (auto it=inBlock.begin(), jt=stuffed.begin();it != inBlock.end();++it)
         {
             *jt = *it;
             ++jt;
@@ -112,7 +108,8 @@ public:
             jt += cnt;
         }
 
-        m_LpFilter->filter(filterBlock, outBlock);
+        m_LpFilter->filter(util::aligned_span<const T> { stuffed }, util::aligned_span<T> { outBlock });
+        block<B>::setGroupDelay((m_LpFilter->getNumTaps() - 1) / 2);
 
         // Resamplers must set the sampling rate on each block processing call
         block<B>::m_SamplingRate *= m_L;
@@ -121,8 +118,44 @@ public:
 private:
 
     uint16_t m_L;
+    bool m_AdjustGain;
     std::unique_ptr<firfilter<T, B>> m_LpFilter;
+
+    // Copy the caller's coefficients, adjusted by L if that was requested.
+    std::vector<float> adjustTaps(const float *taps, const size_t size) const
+    {
+        std::vector<float> adjusted(taps, taps + size);
+
+        if (m_AdjustGain)
+        {
+            for (auto &t : adjusted)
+                t *= m_L;
+        }
+
+        return adjusted;
+    }
+
+    void makeFilter(const float *taps, const size_t size)
+    {
+        m_LpFilter = std::make_unique<firfilter<T, B>>(adjustTaps(taps, size));
+    }
+
+    size_t scratchSize(const size_t maxIn) const
+    {
+        return util::workspace::bytes<T>(maxIn * m_L);
+    }
+};
+
+//! \cond
+template<typename T, typename B>
+struct processor<firinterp<T, B>>
+{
+    static void call(firinterp<T, B> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.interp(in, out);
+    }
 };
+//! \endcond
 
 using firinterp_ff = firinterp<float,dsp::func_ff>;
 using firinterp_cc = firinterp<rm_math::complex_f, dsp::func_cc>;
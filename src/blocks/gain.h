@@ -0,0 +1,89 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <type_traits>
+#include <atomic>
+
+#include "block.h"
+
+namespace dsp {
+
+/*! \brief Gain Block
+ *
+ * This block scales a signal by a **linear** gain. The gain can be changed from any thread while
+ * the block is in use.
+ *
+ * This block processes in place so a chain passes it the same buffer as its input and output. It's
+ * also element-wise so a chain can fuse it with its element-wise neighbors.
+ */
+
+template<typename T, typename B>
+class gain : public block<B>
+{
+    static_assert((std::is_floating_point<T>::value == std::true_type()) || util::is_std_complex_v<T>);
+    static_assert(is_block_func_v<B>);
+
+public:
+
+    //! Create an instance.
+    //! @param [in] g   The **linear** gain.
+    gain(const float g) : block<B> { TYPE_OPERATOR }, m_Gain { g }
+    {
+        block<B>::process = std::bind(&gain::apply, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::kernel = std::bind(&gain::applySpan, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+        block<B>::setInPlace(true);
+    }
+
+    //! Scale a block of samples.
+    //! @param [in]  inBlock    The block of samples to scale.
+    //! @param [out] outBlock   The scaled samples which will be the same size as *inBlock*. This may
+    //!                         be the same instance as *inBlock*.
+    void apply(const util::aligned_ptr<T> &inBlock, util::aligned_ptr<T> &outBlock)
+    {
+        util::init_aligned_ptr_on_resize<T>(outBlock, inBlock.size());
+        applySpan(inBlock.data(), &outBlock[0], inBlock.size());
+    }
+
+    //! Scale a span of samples. This is the element-wise form of *apply()*.
+    //! @param [in]  in     The samples to scale.
+    //! @param [out] out    The scaled samples. This may be the same as *in*.
+    //! @param [in]  n      The number of samples.
+    void applySpan(const T *in, T *out, const size_t n)
+    {
+        // Complex samples are scaled as interleaved I/Q pairs
+        rm_math::vect_scaler_mult(reinterpret_cast<float *>(out),
+                                    reinterpret_cast<const float *>(in),
+                                    m_Gain.load(std::memory_order_relaxed),
+                                    n * (sizeof(T) / sizeof(float)));
+    }
+
+    //! Get the current **linear** gain.
+    float getGain() const { return m_Gain.load(std::memory_order_relaxed); }
+
+    //! Set a new **linear** gain.
+    //! @param [in] g   The new gain.
+    void setGain(const float g) { m_Gain.store(g, std::memory_order_relaxed); }
+
+private:
+
+    std::atomic<float> m_Gain;
+};
+
+//! \cond
+template<typename T, typename B>
+struct processor<gain<T, B>>
+{
+    static void call(gain<T, B> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.apply(in, out);
+    }
+};
+//! \endcond
+
+using gain_ff = gain<float, dsp::func_ff>;
+using gain_cc = gain<rm_math::complex_f, dsp::func_cc>;
+
+}
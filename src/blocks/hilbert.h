@@ -26,4 +26,16 @@ public:
     //! @param [out] outBlock    The block of complex samples which will be the same size as *inBlock*.
     void transform(const util::aligned_ptr<float> &inBlock, util::aligned_ptr<rm_math::complex_f> &outBlock);
 };
+
+//! \cond
+template<>
+struct processor<hilbert>
+{
+    static void call(hilbert &blk, const util::aligned_ptr<float> &in, util::aligned_ptr<rm_math::complex_f> &out)
+    {
+        blk.transform(in, out);
+    }
+};
+//! \endcond
+
 }
@@ -12,6 +12,7 @@
 #include "poly-subfilter.h"
 #include "polyphase.h"
 #include "trace.h"
+#include "hot-swap.h"
 
 namespace dsp {
 
@@ -39,6 +40,9 @@ namespace dsp {
  * rows in the polyphase structure. Similarly, if **L > 1** and **M == 1**, then this reduces
  * to interpolation only and **L** equals the number of rows in the polyphase structure.
  *
+ * The coefficients can be replaced with *setTaps()* while another thread is resampling, e.g., to
+ * retune a channel filter. The new polyphase structure is picked up at the start of the next block
+ * without locking or allocating in the resampler.
  */
 
 template<typename T, typename B>
@@ -80,19 +84,56 @@ public:
         m_SubFilters = util::polyBuildFilter<T, R, C>(taps, gain);
     }
 
+    //! Replace the coefficients. This may be called from one thread while another thread resamples.
+    //! The new coefficients are used from the next block on and the old ones are freed by the next
+    //! call (or when the block is destroyed). The number of rows can't change but the number of
+    //! columns can; the most recent samples are carried over.
+    //! @param [in] taps    The FIR coeffcients in polyphase decomposed form.
+    //! @param [in] gain    The gain which is multipled to each coefficient.
+    //! @return **false** if the number of rows doesn't match the polyphase structure; the
+    //!         coefficients are left as they are.
+    bool setTaps(const std::vector<std::vector<float>> &taps, const uint16_t gain = 1)
+    {
+        if (taps.size() != m_SubFilters.size())
+            return false;
+
+        m_TapSwap.publish(std::make_unique<bank_t>(util::polyBuildFilter<T>(taps, gain)));
+        return true;
+    }
+
+    //! Replace the coefficients. See above.
+    //! @param [in] taps    The FIR coeffcients in polyphase decomposed form.
+    //! @param [in] gain    The gain which is multipled to each coefficient.
+    //! @return **false** if the number of rows doesn't match the polyphase structure.
+    template<size_t R, size_t C>
+    bool setTaps(const std::array<std::array<float, C>, R> &taps, const uint16_t gain = 1)
+    {
+        if (R != m_SubFilters.size())
+            return false;
+
+        m_TapSwap.publish(std::make_unique<bank_t>(util::polyBuildFilter<T, R, C>(taps, gain)));
+        return true;
+    }
+
     //! Resample a block of data
     //! @param [in]  inBlock    The block of input samples.
     //! @param [out] outBlock   The block of processed samples.
     void resample(const util::aligned_ptr<T> &inBlock, util::aligned_ptr<T> &outBlock)
     {
+        m_TapSwap.apply([this](bank_t &next) { swapTaps(next); });
+
+        // The prototype filter runs at L times the input rate
+        block<B>::setGroupDelay((m_SubFilters.size() * m_SubFilters[0].size() - 1) / 2);
         m_Handler(inBlock, outBlock);
     }
 
 private:
 
     using index_t = uint16_t;
+    using bank_t = std::vector<comps::poly_subfilter<float>>;
 
-    std::vector<comps::poly_subfilter<float>> m_SubFilters;
+    bank_t m_SubFilters;
+    util::hot_swap<bank_t> m_TapSwap;
 
     uint16_t m_L;
     uint16_t m_M;
@@ -106,7 +147,21 @@ private:
     static constexpr char const *ID = "RR";
     util::trace<> m_Trace;
 
-    //// helper
+    //// helpers
+    // Called by the resampling thread; the old structure ends up in *next*. A structure with the
+    // wrong number of rows is never swapped in; it is retired as is.
+    bool swapTaps(bank_t &next)
+    {
+        if (next.size() != m_SubFilters.size())
+            return false;
+
+        for (size_t i=0;i < next.size();i++)
+            next[i].copyState(m_SubFilters[i]);
+
+        std::swap(m_SubFilters, next);
+        return true;
+    }
+
     void bindCallbacks()
     {
         // Interpolate?
@@ -130,6 +185,7 @@ private:
         }
 
         block<B>::process = std::bind(&rational_resampler::resample, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::setRateRatio(m_L, m_M);
     }
 
     //// callbacks
@@ -160,6 +216,8 @@ private:
         size_t inIdx = 0;
         size_t outIdx = 0;
 
+        // The next output is due with the input which brings the count down to zero.
+        block<B>::setOutputPhase(m_Mk - 1);
         util::init_aligned_ptr_on_resize<T>(outBlock, sz);
 
         while(inIdx < (inBlock.size() + mod))
@@ -186,6 +244,8 @@ private:
         size_t sz = inBlock.size() * m_L / m_M;
         size_t outIdx = 0;
 
+        // The next output is the phase left over from the last block.
+        block<B>::setOutputPhase(static_cast<int64_t>(m_Mk) - m_L);
         util::init_aligned_ptr_on_resize<T>(outBlock, sz);
 
         for (size_t i=0;i < inBlock.size();i++)
@@ -207,6 +267,17 @@ private:
     }
 };
 
+//! \cond
+template<typename T, typename B>
+struct processor<rational_resampler<T, B>>
+{
+    static void call(rational_resampler<T, B> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.resample(in, out);
+    }
+};
+//! \endcond
+
 using rational_resampler_ff = rational_resampler<float,dsp::func_ff>;
 using rational_resampler_cc = rational_resampler<rm_math::complex_f, dsp::func_cc>;
 
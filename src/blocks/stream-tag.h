@@ -0,0 +1,93 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace dsp {
+
+//! The kind of information a *stream_tag* carries.
+enum tag_key : uint8_t
+{
+    TAG_SAMPLE_INDEX,   // The absolute index of the tagged sample in the stream, at the current sampling rate.
+    TAG_TIME,           // The time in nanoseconds the tagged sample was captured (see util::timer::Ns()).
+    TAG_CENTER_FREQ,    // The center frequency in Hz of the stream from the tagged sample on.
+    TAG_RETUNE          // The stream was retuned to a new center frequency in Hz at the tagged sample.
+};
+
+/*! \brief Metadata Attached to a Sample in a Block
+ *
+ * Tags ride alongside the sample blocks passed through a *util::chain*. Each tag marks one sample of
+ * the block by its offset from the start of the block. Sources attach tags to the blocks they output
+ * and any later block can read them, e.g., a decoder which needs the time or frequency of a burst.
+ * After a resampler a tag moves to the first output sample the tagged input reaches, given the
+ * resampler's phase and filter delay, which may be in a later block; sample indices are rescaled
+ * by the rate ratio.
+ */
+
+struct stream_tag
+{
+    //! The offset of the tagged sample from the start of the block.
+    size_t offset;
+
+    //! What the tag carries.
+    tag_key key;
+
+    //! The value; which member is used depends on *key*.
+    union
+    {
+        uint64_t index;
+        uint64_t timeNs;
+        double freq;
+    };
+
+    //! Create a *TAG_SAMPLE_INDEX* tag.
+    static stream_tag sampleIndex(const size_t offset, const uint64_t index)
+    {
+        stream_tag t;
+        t.offset = offset;
+        t.key = TAG_SAMPLE_INDEX;
+        t.index = index;
+        return t;
+    }
+
+    //! Create a *TAG_TIME* tag.
+    static stream_tag time(const size_t offset, const uint64_t timeNs)
+    {
+        stream_tag t;
+        t.offset = offset;
+        t.key = TAG_TIME;
+        t.timeNs = timeNs;
+        return t;
+    }
+
+    //! Create a *TAG_CENTER_FREQ* tag.
+    static stream_tag centerFreq(const size_t offset, const double freq)
+    {
+        stream_tag t;
+        t.offset = offset;
+        t.key = TAG_CENTER_FREQ;
+        t.freq = freq;
+        return t;
+    }
+
+    //! Create a *TAG_RETUNE* tag.
+    static stream_tag retune(const size_t offset, const double freq)
+    {
+        stream_tag t;
+        t.offset = offset;
+        t.key = TAG_RETUNE;
+        t.freq = freq;
+        return t;
+    }
+};
+
+//! The tags of a block in the order they were attached. The capacity is fixed by the chain so
+//! attaching a tag never allocates; see *util::chain::MAX_TAGS*.
+using tag_list = std::vector<stream_tag>;
+
+}
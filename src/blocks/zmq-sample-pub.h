@@ -5,6 +5,7 @@
 #pragma once
 
 #include "block.h"
+#include "shared-block.h"
 #include "zmq/sample-msg.h"
 
 namespace dsp {
@@ -14,7 +15,11 @@ namespace dsp {
  * This is a chain wrapper for ZMQ support. It simply forwards incoming samples to the
  * global ZMQ context. It can function as an operator or a sink with the only difference
  * being that an operator will copy the samples to the output buffer in addition to forwarding
- * them to the ZMQ context.
+ * them to the ZMQ context. In a chain, an operator processes in place so nothing is copied.
+ *
+ * ZMQ sends from its own I/O thread after the handler returns, by which time the chain may be
+ * writing the next block into the same buffer, so the handler copies the samples into the message.
+ * A *util::shared_block* can be sent with *publish()* instead, which only adds a reference.
  *
   * \tparam T            The type of *aligned_ptr* to create. Either *float* or *std::vector<float>*.
   * \tparam B            The block function type. See block.h.
@@ -38,6 +43,7 @@ public:
     {
         m_Msg.init(socketId);
         block<B>::process = std::bind(&zmq_sample_pub::handler, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::setInPlace(type == TYPE_OPERATOR);
     }
 
     //! Create an instance using a byte array as the ZMQ header.
@@ -50,6 +56,7 @@ public:
 
         m_Msg.init(socketId);
         block<B>::process = std::bind(&zmq_sample_pub::handler, this, std::placeholders::_1, std::placeholders::_2);
+        block<B>::setInPlace(type == TYPE_OPERATOR);
     }
 
     //! Handle incoming samples.
@@ -61,18 +68,38 @@ public:
         // Send to the socket
         m_Msg.send(in);
 
-        // Copy in -> out
-        if (block<B>::getType() == TYPE_OPERATOR)
+        // Copy in -> out unless the chain passed the same buffer for both
+        if ((block<B>::getType() == TYPE_OPERATOR) && (&in != &out))
         {
             util::init_aligned_ptr_on_resize(out, in.size());
             std::copy(in.begin(), in.end(), out.begin());
         }
     }
 
+    //! Publish samples from outside a chain, e.g., a *util::shared_block* which other consumers hold
+    //! as well. Nothing is copied; ZMQ holds a reference until the message has gone out.
+    //! @param [in] samples   The samples to publish.
+    //! @return Zero if successful, -1 otherwise. See *util::zmq::sample_msg::send()*.
+    int publish(const util::shared_block<T> &samples)
+    {
+        return m_Msg.send(samples);
+    }
+
 private:
     util::zmq::sample_msg<T, util::zmq::PUB_EP, size> m_Msg;
 };
 
+//! \cond
+template<typename T, typename B, block_type type, uint8_t size>
+struct processor<zmq_sample_pub<T, B, type, size>>
+{
+    static void call(zmq_sample_pub<T, B, type, size> &blk, const util::aligned_ptr<T> &in, util::aligned_ptr<T> &out)
+    {
+        blk.handler(in, out);
+    }
+};
+//! \endcond
+
 // Convenient aliases for float->float operator and sink objects using string headers
 template<block_type T>
 using zmq_sample_pub_ff = zmq_sample_pub<float, func_ff, T>;
@@ -7,25 +7,22 @@
 
 using namespace comps;
 
-float freq_est::estimate(const util::aligned_ptr<rm_math::complex_f> &in)
+float freq_est::estimate(const util::aligned_ptr<rm_math::complex_f> &in, util::workspace &ws)
 {
-    // delayed sample vector
-    auto v2 = util::make_aligned_ptr<rm_math::complex_f>(in.size());
-
-    // result vector
-    auto v3 = util::make_aligned_ptr<rm_math::complex_f>(in.size());
+    auto delayed = ws.get<rm_math::complex_f>(in.size());
+    auto product = ws.get<rm_math::complex_f>(in.size());
 
     // Run the data through the delay block to make the second vector
     for (size_t i=0;i < in.size();i++)
-        v2[i] = m_Delay << in[i];
+        delayed[i] = m_Delay << in[i];
 
     // Do the math
-    rm_math::mult_conj(&v3[0], in.data(), v2.data(), in.size());
+    rm_math::mult_conj(product.data(), in.data(), delayed.data(), in.size());
 
     // Sum the result to average out the noise
     rm_math::complex_f sum = { 0.0f, 0.0f };
     for (size_t i=0;i < in.size();i++)
-        sum += v3[i];
+        sum += product[i];
 
     // Finally determine the phase difference which is the current
     // frequency estimate.
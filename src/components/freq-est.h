@@ -5,6 +5,7 @@
 #pragma once
 
 #include "aligned-ptr.h"
+#include "workspace.h"
 #include "delay.h"
 #include "rm-math.h"
 
@@ -36,15 +37,41 @@ public:
     //! @param [in] in      The block of samples with which to make an estimation.
     //!
     //! @return The scaled estimate.
-    float estimate(const util::aligned_ptr<rm_math::complex_f> &in);
+    float estimate(const util::aligned_ptr<rm_math::complex_f> &in)
+    {
+        return estimate(in, m_Scratch.get(scratchSize(in.size())));
+    }
+
+    //! Estimate a block of samples using the caller's scratch space, e.g., a block's workspace.
+    //! @param [in] in      The block of samples with which to make an estimation.
+    //! @param [in] ws      The workspace; it must hold *scratchSize()* bytes for *in*.
+    //!
+    //! @return The scaled estimate.
+    float estimate(const util::aligned_ptr<rm_math::complex_f> &in, util::workspace &ws);
+
+    //! Get the scratch space, in bytes, *estimate()* needs for a block of *size* samples.
+    static size_t scratchSize(const size_t size)
+    {
+        return 2 * util::workspace::bytes<rm_math::complex_f>(size);
+    }
 
     //! Update the scaling factor.
     //! @param [in] scale   The new scaling factor.
     void setScale(float scale) { m_Scale = scale; }
 
+    //! Size the scratch space used when no workspace is given up front.
+    //! @param [in] size    The largest block *estimate()* will be called with.
+    void reserve(const size_t size)
+    {
+        m_Scratch.reserve(scratchSize(size));
+    }
+
 private:
     float m_Scale;
     delay<rm_math::complex_f> m_Delay;
+
+    // Used by callers which don't pass a workspace
+    util::scratch_buffer m_Scratch;
 };
 
 }
@@ -6,6 +6,8 @@
 
 #include <vector>
 #include <array>
+#include <algorithm>
+#include <cstring>
 
 #include "aligned-ptr.h"
 
@@ -68,6 +70,17 @@ public:
         return out;
     }
 
+    //! Get the number of taps of the sub-filter.
+    size_t size() const { return m_Taps.size(); }
+
+    //! Carry the most recent samples in the delay line of another sub-filter over to this one, e.g.,
+    //! when this one replaces it in a running filter. This does not allocate.
+    //! @param [in] other  The sub-filter being replaced.
+    void copyState(const poly_subfilter &other)
+    {
+        std::memcpy(&m_State[0], other.m_State.data(), std::min(m_State.size(), other.m_State.size()) * sizeof(T));
+    }
+
     //! Allow copying for building polyphase structures.
     poly_subfilter(const poly_subfilter &other)
     {
@@ -0,0 +1,209 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "rm-math.h"
+
+namespace util {
+
+//! Counters of the pool of the calling thread, see *aligned_pool::getStats()*.
+struct aligned_pool_stats
+{
+    uint64_t hits;          // Allocations served from the pool
+    uint64_t misses;        // Allocations which went to *rm_math::rm_malloc()*
+    size_t cachedBytes;     // Bytes held by the pool, ready for reuse
+};
+
+/*! \brief Thread-local Size-class Pool of Aligned Buffers
+ *
+ * This is what *aligned_ptr* allocates from. Requests are rounded up to a power of two size class
+ * between 64 bytes and 16 MiB and served from a per-thread free list of that class. Freed buffers go
+ * back on the free list of the thread freeing them instead of to *rm_math::rm_free()*, so a block
+ * which creates the same temporaries on every call only reaches the math library allocator the first
+ * time. A buffer allocated on one thread and freed on another (e.g., a block passed down a pipeline
+ * stage) simply moves to the second thread's pool. Every buffer in the pool came from
+ * *rm_math::rm_malloc()* so the alignment is the same as before.
+ *
+ * Each thread caches at most *MAX_PER_CLASS* buffers of a class and *MAX_CACHED_BYTES* in total;
+ * anything beyond that, and any request larger than the largest class, goes straight to the math
+ * library. The cache of a thread is freed when the thread exits or on *trim()*.
+ *
+ * The pool is bypassed when *ALIGNED_PTR_NO_POOL* is defined, or when building with the address
+ * sanitizer, so use-after-free of a buffer is still reported.
+ */
+
+class aligned_pool
+{
+public:
+
+#if defined(ALIGNED_PTR_NO_POOL) || defined(__SANITIZE_ADDRESS__)
+    static constexpr bool ENABLED = false;
+#else
+    static constexpr bool ENABLED = true;
+#endif
+
+    static constexpr size_t MIN_CLASS_SHIFT = 6;
+    static constexpr size_t MAX_CLASS_SHIFT = 24;
+    static constexpr size_t CLASSES = MAX_CLASS_SHIFT - MIN_CLASS_SHIFT + 1;
+    static constexpr uint32_t MAX_PER_CLASS = 16;
+    static constexpr size_t MAX_CACHED_BYTES = 64 * 1024 * 1024;
+
+    //! Allocate an aligned buffer.
+    //! @param [in] bytes   The size of the buffer in bytes.
+    //! @return The buffer. It must be released with *release()* and the same *bytes*.
+    static void* alloc(const size_t bytes)
+    {
+        const int c = sizeClass(bytes);
+
+        if (!ENABLED || c < 0)
+            return rm_math::rm_malloc<uint8_t>(bytes);
+
+        state &s = local();
+
+        if (s.head[c])
+        {
+            free_node *n = s.head[c];
+
+            s.head[c] = n->next;
+            --s.count[c];
+            s.cachedBytes -= classBytes(c);
+            ++s.hits;
+
+            return n;
+        }
+
+        ++s.misses;
+        return rm_math::rm_malloc<uint8_t>(classBytes(c));
+    }
+
+    //! Return a buffer to the pool of the calling thread.
+    //! @param [in] ptr     The buffer from *alloc()*.
+    //! @param [in] bytes   The size passed to *alloc()*.
+    static void release(void *ptr, const size_t bytes)
+    {
+        const int c = sizeClass(bytes);
+
+        if (!ENABLED || c < 0)
+        {
+            rm_math::rm_free(ptr);
+            return;
+        }
+
+        state &s = local();
+
+        if (s.closed || (s.count[c] >= MAX_PER_CLASS) || (s.cachedBytes + classBytes(c) > MAX_CACHED_BYTES))
+        {
+            rm_math::rm_free(ptr);
+            return;
+        }
+
+        if (!s.armed)
+            arm();
+
+        free_node *n = static_cast<free_node*>(ptr);
+
+        n->next = s.head[c];
+        s.head[c] = n;
+        ++s.count[c];
+        s.cachedBytes += classBytes(c);
+    }
+
+    //! Free every buffer cached by the calling thread.
+    static void trim()
+    {
+        state &s = local();
+
+        for (size_t c=0;c < CLASSES;c++)
+        {
+            while(s.head[c])
+            {
+                free_node *n = s.head[c];
+
+                s.head[c] = n->next;
+                rm_math::rm_free(n);
+            }
+
+            s.count[c] = 0;
+        }
+
+        s.cachedBytes = 0;
+    }
+
+    //! Get the counters of the pool of the calling thread.
+    static void getStats(aligned_pool_stats &stats)
+    {
+        state &s = local();
+
+        stats.hits = s.hits;
+        stats.misses = s.misses;
+        stats.cachedBytes = s.cachedBytes;
+    }
+
+private:
+
+    //! \cond
+    struct free_node
+    {
+        free_node *next;
+    };
+
+    // Trivially destructible so it's still usable by buffers freed after the thread's destructors ran.
+    struct state
+    {
+        free_node *head[CLASSES];
+        uint32_t count[CLASSES];
+        size_t cachedBytes;
+        uint64_t hits;
+        uint64_t misses;
+        bool armed;
+        bool closed;
+    };
+
+    // Frees the cache on thread exit; only constructed once the thread caches something.
+    struct reaper
+    {
+        ~reaper()
+        {
+            trim();
+            local().closed = true;
+        }
+    };
+
+    static state& local()
+    {
+        static thread_local state s {};
+        return s;
+    }
+
+    static void arm()
+    {
+        static thread_local reaper r;
+        (void)r;
+        local().armed = true;
+    }
+
+    static int sizeClass(const size_t bytes)
+    {
+        if (bytes > (size_t(1) << MAX_CLASS_SHIFT))
+            return -1;
+
+        if (bytes <= (size_t(1) << MIN_CLASS_SHIFT))
+            return 0;
+
+        // The number of bits needed for bytes - 1 is the shift of the next power of two
+        return static_cast<int>(64 - __builtin_clzll(bytes - 1) - MIN_CLASS_SHIFT);
+    }
+
+    static constexpr size_t classBytes(const int c)
+    {
+        return size_t(1) << (c + MIN_CLASS_SHIFT);
+    }
+    //! \endcond
+};
+
+}
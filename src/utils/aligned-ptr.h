@@ -9,8 +9,12 @@
 #include <memory>
 #include <iterator>
 #include <cstddef>
+#include <cstdint>
 
 #include "rm-math.h"
+#include "aligned-pool.h"
+#include "aligned-span.h"
+#include "page-alloc.h"
 
 namespace util {
 
@@ -35,10 +39,30 @@ namespace util {
  *
  * See examples throughout the source code, especially in the *block* directory.
  *
+ * Dynamic buffers come from the thread-local *aligned_pool* and go back to it when freed, so
+ * re-creating a temporary of the same size is cheap after the first time. Use *subspan()*, or
+ * an *aligned_span*, to pass part of a buffer along without copying it. Large, long lived buffers
+ * can instead be mapped in huge pages or bound to a NUMA node, see *set_aligned_ptr_policy()*.
+ *
  * \note Aligment of static buffers are **NOT** guaranteed. The caller is responsible
  * for ensuring this when creating the buffer if alignment is necessary.
  */
 
+//! \cond
+inline uint64_t& aligned_ptr_alloc_count()
+{
+    static thread_local uint64_t count = 0;
+    return count;
+}
+//! \endcond
+
+//! Get the number of buffers allocated by *aligned_ptr* instances on the calling thread. Take the
+//! difference of two calls to find out if the code in between allocated anything.
+inline uint64_t aligned_ptr_allocs()
+{
+    return aligned_ptr_alloc_count();
+}
+
 //! Helper functions to intialize an empty instance. You can call these mulitple times
 //! to re-initialize if desired.
 template<typename T>
@@ -131,6 +155,33 @@ void init_aligned_ptr_on_resize(aligned_ptr<T> &ap, const size_t size, const T *
     }
 }
 
+//! Set how the buffer of a dynamic instance is allocated, see *util::page_alloc*. An existing buffer
+//! is re-allocated under the new policy and keeps its contents. The policy sticks to the instance;
+//! later re-allocations use it as well.
+template<typename T>
+void set_aligned_ptr_policy(aligned_ptr<T> &ap, const mem_policy policy)
+{
+    static_assert(is_std_complex_v<T> || (std::is_arithmetic<T>::value == std::true_type()));
+    if (ap.m_IsStatic || (ap.m_Policy == policy))
+        return;
+
+    if (!ap.m_Ptr)
+    {
+        ap.m_Policy = policy;
+        return;
+    }
+
+    aligned_ptr<T> next;
+
+    next.m_Policy = policy;
+    next.create_ptr(ap.m_Capacity);
+    next.m_Size = ap.m_Size;
+    next.m_Capacity = ap.m_Capacity;
+    std::memcpy(next.m_Ptr, ap.m_Ptr, ap.m_Size * sizeof(T));
+
+    ap = std::move(next);
+}
+
 //! Only for static buffer instances or to convert dynamic buffer instances
 //! to a static buffer instance.
 template<typename T>
@@ -152,16 +203,16 @@ public:
 
     //! Default constructor - creates an instance in the cleared state.
     //! Use one of the *init_aligned_ptr()* helpers to set things up when ready.
-    aligned_ptr() : m_Ptr{nullptr}, m_Size{0}, m_IsStatic{false}, m_Capacity{0} { }
+    aligned_ptr() : m_Ptr{nullptr}, m_Size{0}, m_IsStatic{false}, m_Policy{MEM_DEFAULT}, m_Capacity{0} { }
 
     //! parametric constuctor #1
-    explicit aligned_ptr(const size_t size) : m_Ptr{nullptr}, m_Size{size}, m_IsStatic{false}, m_Capacity{size}
+    explicit aligned_ptr(const size_t size) : m_Ptr{nullptr}, m_Size{size}, m_IsStatic{false}, m_Policy{MEM_DEFAULT}, m_Capacity{size}
     {
         create_ptr(size);
     }
 
     //! parametric constructor #2
-    aligned_ptr(const size_t size, const T *values) : m_Ptr{nullptr}, m_Size{size}, m_IsStatic{false}, m_Capacity{size}
+    aligned_ptr(const size_t size, const T *values) : m_Ptr{nullptr}, m_Size{size}, m_IsStatic{false}, m_Policy{MEM_DEFAULT}, m_Capacity{size}
     {
         create_ptr(size);
         std::memcpy(m_Ptr, values, size * sizeof(T));
@@ -178,6 +229,7 @@ public:
 
         m_Size = other.m_Size;
         m_IsStatic = other.m_IsStatic;
+        m_Policy = other.m_Policy;
         m_Capacity = other.m_Capacity;
         create_ptr(m_Capacity);
         std::memcpy(m_Ptr, other.m_Ptr, m_Size * sizeof(T));
@@ -192,8 +244,10 @@ public:
         if (m_Ptr == other.m_Ptr)
             return *this;
 
+        del_ptr();
         m_Size = other.m_Size;
         m_IsStatic = other.m_IsStatic;
+        m_Policy = other.m_Policy;
         m_Capacity = other.m_Capacity;
 
         create_ptr(m_Capacity);
@@ -208,6 +262,7 @@ public:
         m_Ptr = std::exchange(other.m_Ptr, nullptr);
         m_Size = std::exchange(other.m_Size, 0);
         m_IsStatic = std::exchange(other.m_IsStatic, false);
+        m_Policy = std::exchange(other.m_Policy, MEM_DEFAULT);
         m_Capacity = std::exchange(other.m_Capacity, 0);
     }
 
@@ -221,6 +276,7 @@ public:
         m_Ptr = std::exchange(other.m_Ptr, nullptr);
         m_Size = std::exchange(other.m_Size, 0);
         m_IsStatic = std::exchange(other.m_IsStatic, false);
+        m_Policy = std::exchange(other.m_Policy, MEM_DEFAULT);
         m_Capacity = std::exchange(other.m_Capacity, 0);
 
         return *this;
@@ -250,6 +306,24 @@ public:
         return m_Ptr;
     }
 
+    //! Get the pointer of the contained buffer.
+    T* data()
+    {
+        return m_Ptr;
+    }
+
+    //! Get a view of *count* elements starting at *offset* without copying them.
+    aligned_span<const T> subspan(const size_t offset, const size_t count) const
+    {
+        return aligned_span<const T>(m_Ptr, m_Size).subspan(offset, count);
+    }
+
+    //! Get a view of *count* elements starting at *offset* without copying them.
+    aligned_span<T> subspan(const size_t offset, const size_t count)
+    {
+        return aligned_span<T>(m_Ptr, m_Size).subspan(offset, count);
+    }
+
     //! Get the number of elements in the contained buffer.
     const size_t size() const
     {
@@ -268,6 +342,12 @@ public:
         return m_Capacity;
     }
 
+    //! Get how the buffer is allocated, see *set_aligned_ptr_policy()*.
+    mem_policy policy() const
+    {
+        return m_Policy;
+    }
+
     //! Reset the instance to a default contructed state
     void clear()
     {
@@ -381,18 +461,30 @@ private:
         {
             if (m_Ptr)
             {
-                rm_math::rm_free(m_Ptr);
+                if (m_Policy == MEM_DEFAULT)
+                    aligned_pool::release(m_Ptr, m_Capacity * sizeof(T));
+                else
+                    page_alloc::release(m_Ptr, m_Capacity * sizeof(T), m_Policy);
+
                 m_Ptr = nullptr;
             }
 
             m_Size = 0;
+            m_Capacity = 0;
         }
     }
 
     void create_ptr(size_t size)
     {
         if (!m_IsStatic)
-            m_Ptr = rm_math::rm_malloc<T>(size * sizeof(T));
+        {
+            if (m_Policy == MEM_DEFAULT)
+                m_Ptr = static_cast<T*>(aligned_pool::alloc(size * sizeof(T)));
+            else
+                m_Ptr = static_cast<T*>(page_alloc::alloc(size * sizeof(T), m_Policy));
+
+            ++aligned_ptr_alloc_count();
+        }
     }
 
     friend void init_aligned_ptr<>(aligned_ptr<T> &ap, const size_t size);
@@ -400,15 +492,17 @@ private:
     friend void init_aligned_ptr_on_resize<>(aligned_ptr<T> &ap, const size_t size);
     friend void init_aligned_ptr_on_resize<>(aligned_ptr<T> &ap, const size_t size, const T *values);
     friend void init_aligned_ptr_static<>(aligned_ptr<T> &ap, size_t size, const T *buff);
+    friend void set_aligned_ptr_policy<>(aligned_ptr<T> &ap, const mem_policy policy);
 
     // RAM usage
     T* m_Ptr;
     size_t m_Size;
     bool m_IsStatic;
+    mem_policy m_Policy;
     size_t m_Capacity;
 };
 
-//! Helper functions to create an instance on the heap. If you want to initialize
+//! Helper functions to create an instance. If you want to initialize
 //! an empty instance (default constructed), use one of the init_aligned_ptr()
 //! functions at the top of this file which are more efficient than instantiating
 //! and moving a new instance.
@@ -416,23 +510,23 @@ template<typename T>
 aligned_ptr<T> make_aligned_ptr(const size_t size)
 {
     static_assert(is_std_complex_v<T> || (std::is_arithmetic<T>::value == std::true_type()));
-    return std::move(*(new aligned_ptr<T>(size)));
+    return aligned_ptr<T>(size);
 }
 
 template<typename T>
 aligned_ptr<T> make_aligned_ptr(const size_t size, const T *values)
 {
     static_assert(is_std_complex_v<T> || (std::is_arithmetic<T>::value == std::true_type()));
-    return std::move(*(new aligned_ptr<T>(size, values)));
+    return aligned_ptr<T>(size, values);
 }
 
 template<typename T>
 aligned_ptr<T> make_aligned_ptr_static(const size_t size, const T *buffer)
 {
     static_assert(is_std_complex_v<T> || (std::is_arithmetic<T>::value == std::true_type()));
-    auto *p = new aligned_ptr<T>();
-    init_aligned_ptr_static<T>(*p, size, buffer);
+    aligned_ptr<T> p;
+    init_aligned_ptr_static<T>(p, size, buffer);
 
-    return std::move(*p);
+    return p;
 }
 }
\ No newline at end of file
@@ -0,0 +1,122 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace util {
+
+/*! \brief Non-owning View of a Contiguous Run of Samples
+ *
+ * An *aligned_span* refers to samples owned by something else, e.g., an *aligned_ptr*, a std::vector
+ * or a std::array, or a slice of one. Creating one or slicing it with *subspan()* costs nothing, so
+ * use it to hand part of a buffer to a kernel or block instead of copying the part into another
+ * *aligned_ptr*. Use *aligned_span<const T>* for read only views; a mutable span converts to one.
+ *
+ * The span carries the alignment of its first sample, the largest power of two (up to
+ * *MAX_ALIGNMENT*) dividing its address. A span of a dynamic *aligned_ptr* has at least the
+ * alignment of the math library; slicing it at an odd offset lowers the alignment accordingly.
+ *
+ * \note The span is only valid as long as the samples it refers to; e.g., resizing the *aligned_ptr*
+ * it was taken from may invalidate it.
+ */
+
+template<typename T>
+class aligned_span
+{
+public:
+
+    //! The largest alignment, in bytes, a span reports.
+    static constexpr size_t MAX_ALIGNMENT = 64;
+
+    using element_type = T;
+    using value_type = typename std::remove_cv<T>::type;
+    using iterator = T*;
+
+    //! Create an empty span.
+    aligned_span() : m_Ptr { nullptr }, m_Size { 0 }, m_Alignment { MAX_ALIGNMENT } { }
+
+    //! Create a span of *size* samples starting at *ptr*.
+    aligned_span(T *ptr, const size_t size) : m_Ptr { ptr }, m_Size { size }, m_Alignment { alignmentOf(ptr) } { }
+
+    //! Create a span of a whole container, e.g., an *aligned_ptr*, std::vector or std::array.
+    template<typename C, typename = std::enable_if_t<std::is_convertible<decltype(std::declval<C&>().data()), T*>::value>>
+    aligned_span(C &c) : aligned_span(c.data(), c.size()) { }
+
+    //! Create a read only span from a mutable one.
+    template<typename U, typename = std::enable_if_t<std::is_same<const U, T>::value>>
+    aligned_span(const aligned_span<U> &other) : m_Ptr { other.data() }, m_Size { other.size() }, m_Alignment { other.alignment() } { }
+
+    T* data() const { return m_Ptr; }
+    size_t size() const { return m_Size; }
+    bool empty() const { return !m_Size; }
+
+    //! Get the alignment, in bytes, of the first sample.
+    size_t alignment() const { return m_Alignment; }
+
+    //! Check if the first sample is aligned to at least *bytes*, e.g., *volk_get_alignment()*.
+    bool isAligned(const size_t bytes) const { return m_Alignment >= bytes; }
+
+    T& operator[](const size_t i) const
+    {
+        assert(i < m_Size);
+        return m_Ptr[i];
+    }
+
+    iterator begin() const { return m_Ptr; }
+    iterator end() const { return m_Ptr + m_Size; }
+
+    //! Get a span of *count* samples starting at *offset*.
+    aligned_span subspan(const size_t offset, const size_t count) const
+    {
+        assert((offset + count) <= m_Size);
+        return aligned_span(m_Ptr + offset, count);
+    }
+
+    //! Get a span of the samples from *offset* to the end.
+    aligned_span subspan(const size_t offset) const
+    {
+        assert(offset <= m_Size);
+        return aligned_span(m_Ptr + offset, m_Size - offset);
+    }
+
+    //! Get a span of the first *count* samples.
+    aligned_span first(const size_t count) const { return subspan(0, count); }
+
+    //! Get a span of the last *count* samples.
+    aligned_span last(const size_t count) const { return subspan(m_Size - count, count); }
+
+private:
+
+    T *m_Ptr;
+    size_t m_Size;
+    size_t m_Alignment;
+
+    static size_t alignmentOf(const T *ptr)
+    {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(ptr) | MAX_ALIGNMENT;
+        return static_cast<size_t>(addr & (~addr + 1));
+    }
+};
+
+//! Create a read only span of a whole container.
+template<typename C>
+auto make_span(const C &c) -> aligned_span<const typename std::remove_pointer<decltype(c.data())>::type>
+{
+    return { c.data(), c.size() };
+}
+
+//! Create a mutable span of a whole container.
+template<typename C>
+auto make_span(C &c) -> aligned_span<typename std::remove_pointer<decltype(c.data())>::type>
+{
+    return { c.data(), c.size() };
+}
+
+}
@@ -0,0 +1,461 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cstring>
+#include <cassert>
+
+#include "timer.h"
+#include "rm-math.h"
+#include "page-alloc.h"
+#include "spsc-queue.h"
+#include "wait-event.h"
+#include "ring-buffer.h"
+
+namespace util {
+
+//! What a *broadcast_ring_buffer* does when a reader falls a whole buffer behind.
+enum slow_reader_policy : uint8_t
+{
+    SLOW_READER_BLOCK,  // The writer waits for the reader.
+    SLOW_READER_DROP    // The writer carries on; the reader skips to the newest data and counts the loss.
+};
+
+//! Per reader diagnostics returned in a call to *broadcast_ring_buffer::diagnostics()*.
+struct broadcast_reader_diag
+{
+    //! The number of samples the reader is behind the writer right now.
+    uint32_t    lag;
+    //! The most the reader has been behind when it read.
+    uint32_t    maxLag;
+    //! The number of times the reader had to wait for data.
+    uint32_t    emptyCount;
+    //! The number of times a *SLOW_READER_DROP* reader was overrun and skipped ahead.
+    uint32_t    resyncCount;
+    //! The number of samples it skipped doing so.
+    uint64_t    dropped;
+};
+
+/*! \brief Ring Buffer with One Writer and Several Readers
+ *
+ * Feeds one source, e.g., an audio or SDR capture, to several consumers running at their own pace
+ * from a single copy of the data. Each reader has a cursor of its own, on a cache line of its own,
+ * and reads everything the writer writes after it was added. The indices run freely and are masked
+ * on access like those of *ring_buffer*.
+ *
+ * A reader is added with a *slow_reader_policy*. The writer only waits for *SLOW_READER_BLOCK*
+ * readers, i.e., for the slowest of them to make room. A *SLOW_READER_DROP* reader never holds the
+ * writer up; when it's overrun it skips to the newest data, losing what it hadn't read, and the loss
+ * shows in its *broadcast_reader_diag*. The writer announces the region it's about to overwrite
+ * before touching it, so a reader copying data which gets overwritten meanwhile notices and
+ * resyncs instead of returning torn samples.
+ *
+ * Add the readers before the writer starts; a reader which stops reading must be *detach()*ed or a
+ * blocking reader stalls the writer. The wait mode works as for *ring_buffer*; with *RB_WAIT_EVENT*
+ * a write wakes every waiting reader.
+ */
+
+template <typename T>
+class broadcast_ring_buffer
+{
+    static_assert((std::is_integral<T>::value == std::true_type()) ||
+                    (std::is_floating_point<T>::value == std::true_type()) ||
+                    (util::is_std_complex_v<T>));
+public:
+
+    //! The most readers a buffer can have.
+    static constexpr uint32_t MAX_READERS = 8;
+
+    //! Diagnostic structure returned in a call to *diagnostics()*.
+    using diag = broadcast_reader_diag;
+
+    //! Create an instance.
+    //! @param [in] size        The number of elements the buffer will hold. This must be mod-2.
+    //! @param [in] yieldTime   Time in microseconds to yield while waiting.
+    //! @param [in] policy      How the buffer is allocated; see *util::page_alloc*.
+    broadcast_ring_buffer(const uint32_t size, const uint32_t yieldTime = 1000, const mem_policy policy = MEM_DEFAULT) :
+                m_Capacity { size },
+                m_Mask { m_Capacity - 1 },
+                m_YieldTime { yieldTime },
+                m_Policy { static_cast<mem_policy>(policy & ~MEM_MIRRORED) },
+                m_Buff { nullptr },
+                m_WaitMode { RB_WAIT_YIELD },
+                m_Abort { 0 },
+                m_NumReaders { 0 },
+                m_WriteIdx { 0 },
+                m_ClaimIdx { 0 },
+                m_MinCache { 0 },
+                m_WaitForNotFullCount { 0 }
+    {
+        assert((size > 0) && !(size & (size - 1)));
+        m_Buff = static_cast<T*>(page_alloc::alloc(m_Capacity * sizeof(T), m_Policy));
+        assert(m_Buff);
+    }
+
+    ~broadcast_ring_buffer()
+    {
+        page_alloc::release(m_Buff, m_Capacity * sizeof(T), m_Policy);
+    }
+
+    broadcast_ring_buffer() = delete;
+
+    broadcast_ring_buffer(const broadcast_ring_buffer&) = delete;
+    broadcast_ring_buffer& operator=(const broadcast_ring_buffer&) = delete;
+
+    broadcast_ring_buffer(broadcast_ring_buffer&&) = delete;
+    broadcast_ring_buffer& operator=(broadcast_ring_buffer&&) = delete;
+
+    //! Set how the writer and readers wait for each other. Set it before any of them start.
+    //! @param [in] mode  The wait mode. The default is *RB_WAIT_YIELD*.
+    void setWaitMode(const ring_wait_mode mode) { m_WaitMode = mode; }
+
+    //! Add a reader. It reads from the current write position on.
+    //! @param [in] policy  What to do when the reader falls a whole buffer behind.
+    //! @return The id the reader passes to *read()*, or -1 if there are *MAX_READERS* already.
+    int addReader(const slow_reader_policy policy)
+    {
+        const uint32_t id = m_NumReaders.load(std::memory_order_relaxed);
+
+        if (id >= MAX_READERS)
+            return -1;
+
+        auto &r = m_Readers[id];
+        const uint32_t wr = m_WriteIdx.load(std::memory_order_acquire);
+
+        r.policy = policy;
+        r.idx.store(wr, std::memory_order_relaxed);
+        r.writeCache = wr;
+        r.active.store(true, std::memory_order_relaxed);
+
+        m_NumReaders.store(id + 1, std::memory_order_release);
+        return static_cast<int>(id);
+    }
+
+    //! Stop the writer waiting for a reader which won't read any more. Only that reader's thread,
+    //! or any thread once the reader has stopped, may call this.
+    //! @param [in] id  The reader.
+    void detach(const int id)
+    {
+        assert((id >= 0) && (static_cast<uint32_t>(id) < m_NumReaders.load(std::memory_order_relaxed)));
+
+        m_Readers[id].active.store(false, std::memory_order_release);
+
+        if (m_WaitMode == RB_WAIT_EVENT)
+            m_SpaceEvent.notify();
+    }
+
+    //! Write data to the buffer, waiting for blocking readers to make room as needed. Only the
+    //! writer may call this.
+    //! @param [in] buff  The data to write.
+    //! @param [in] sz    The number of elements to write.
+    void write(const T *buff, const size_t sz)
+    {
+        size_t done = 0;
+
+        while(done < sz)
+        {
+            const uint32_t space = waitNotFull();
+            if (isAborted()) return;
+
+            const uint32_t n = static_cast<uint32_t>(std::min<size_t>(space, sz - done));
+            const uint32_t idx = m_WriteIdx.load(std::memory_order_relaxed);
+
+            // Announce the region before overwriting it so a dropping reader copying from it can
+            // tell; the fence keeps the stores to the buffer after the announcement.
+            m_ClaimIdx.store(idx + n, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            const uint32_t off = idx & m_Mask;
+            const uint32_t first = std::min(n, m_Capacity - off);
+
+            std::memcpy(m_Buff + off, buff + done, first * sizeof(T));
+
+            if (n > first)
+                std::memcpy(m_Buff, buff + done + first, (n - first) * sizeof(T));
+
+            m_WriteIdx.store(idx + n, std::memory_order_release);
+
+            if (m_WaitMode == RB_WAIT_EVENT)
+                m_DataEvent.notify();
+
+            done += n;
+        }
+    }
+
+    //! Read data for a reader. This will block until the requested amount is read. Only that
+    //! reader's thread may call this.
+    //! @param [in]  id    The reader.
+    //! @param [in]  buff  The buffer to place the read data in.
+    //! @param [in]  sz    The number of elements to read. It can't be more than the buffer holds.
+    void read(const int id, T *buff, const size_t sz)
+    {
+        assert(sz <= m_Capacity);
+        assert((id >= 0) && (static_cast<uint32_t>(id) < m_NumReaders.load(std::memory_order_relaxed)));
+
+        auto &r = m_Readers[id];
+        const uint32_t amt = static_cast<uint32_t>(sz);
+
+        while(1)
+        {
+            waitForAmount(r, amt);
+            if (isAborted()) return;
+
+            const uint32_t rd = r.idx.load(std::memory_order_relaxed);
+            const uint32_t lag = r.writeCache - rd;
+
+            if (lag > m_Capacity)
+            {
+                resync(r, rd);
+                continue;
+            }
+
+            r.maxLag.store(std::max(lag, r.maxLag.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+
+            const uint32_t off = rd & m_Mask;
+            const uint32_t first = std::min(amt, m_Capacity - off);
+
+            std::memcpy(buff, m_Buff + off, first * sizeof(T));
+
+            if (amt > first)
+                std::memcpy(buff + first, m_Buff, (amt - first) * sizeof(T));
+
+            // A blocking reader can't be overrun; a dropping one checks nothing it copied was
+            // claimed by the writer meanwhile.
+            if (r.policy == SLOW_READER_DROP)
+            {
+                std::atomic_thread_fence(std::memory_order_acquire);
+
+                if ((m_ClaimIdx.load(std::memory_order_relaxed) - rd) > m_Capacity)
+                {
+                    resync(r, rd);
+                    continue;
+                }
+            }
+
+            r.idx.store(rd + amt, std::memory_order_release);
+
+            if ((m_WaitMode == RB_WAIT_EVENT) && (r.policy == SLOW_READER_BLOCK))
+                m_SpaceEvent.notify();
+
+            return;
+        }
+    }
+
+    //! Get the diagnostic values of a reader. This may be called from any thread.
+    //! @param [in]  id  The reader.
+    //! @param [out] d   Reference to a diagnostic structure.
+    void diagnostics(const int id, diag &d)
+    {
+        auto &r = m_Readers[id];
+        const uint32_t rd = r.idx.load(std::memory_order_acquire);
+
+        d.lag = m_WriteIdx.load(std::memory_order_acquire) - rd;
+        d.maxLag = r.maxLag.load(std::memory_order_relaxed);
+        d.emptyCount = r.waitCount.load(std::memory_order_relaxed);
+        d.resyncCount = r.resyncCount.load(std::memory_order_relaxed);
+        d.dropped = r.dropped.load(std::memory_order_relaxed);
+    }
+
+    //! Get the number of times the writer had to wait for a blocking reader. This may be called from
+    //! any thread.
+    uint32_t fullCount()
+    {
+        return m_WaitForNotFullCount.load(std::memory_order_relaxed);
+    }
+
+    //! Get the number of readers added.
+    uint32_t readers() const { return m_NumReaders.load(std::memory_order_acquire); }
+
+    //! Set the abort state, releasing the writer and every reader; see *ring_buffer::abort()*.
+    //! @param [in] code  The non-zero code describing the abort reason.
+    void abort(int code = -1)
+    {
+        m_Abort.store(code, std::memory_order_release);
+
+        m_DataEvent.notify();
+        m_SpaceEvent.notify();
+    }
+
+    //! Get the current abort code.
+    //! @return The abort code.
+    int abortcode()
+    {
+        return m_Abort.load(std::memory_order_acquire);
+    }
+
+private:
+
+    //! \cond
+    // Each reader's state is on lines of its own. Only the reader writes it, except *active*.
+    struct reader_state
+    {
+        std::atomic<uint32_t> idx { 0 };
+        uint32_t writeCache { 0 };
+        slow_reader_policy policy { SLOW_READER_BLOCK };
+        std::atomic<bool> active { false };
+        std::atomic<uint32_t> maxLag { 0 };
+        std::atomic<uint32_t> waitCount { 0 };
+        std::atomic<uint32_t> resyncCount { 0 };
+        std::atomic<uint64_t> dropped { 0 };
+        uint8_t pad[CACHE_LINE_SIZE];
+    };
+    //! \endcond
+
+    // Read mostly; set at construction
+    uint32_t    m_Capacity;
+    uint32_t    m_Mask;
+    uint32_t    m_YieldTime;
+    mem_policy  m_Policy;
+
+    T*          m_Buff;
+    ring_wait_mode m_WaitMode;
+
+    std::atomic<int> m_Abort;
+    std::atomic<uint32_t> m_NumReaders;
+
+    // Writer side: its index, the end of the region it's writing, its last look at the slowest
+    // blocking reader and its wait count
+    uint8_t m_Pad0[CACHE_LINE_SIZE];
+    std::atomic<uint32_t> m_WriteIdx;
+    std::atomic<uint32_t> m_ClaimIdx;
+    uint32_t m_MinCache;
+    std::atomic<uint32_t> m_WaitForNotFullCount;
+    uint8_t m_Pad1[CACHE_LINE_SIZE - 4 * sizeof(uint32_t)];
+
+    reader_state m_Readers[MAX_READERS];
+
+    // Event mode: readers block on m_DataEvent, the writer on m_SpaceEvent.
+    wait_event m_DataEvent;
+    uint8_t m_Pad2[CACHE_LINE_SIZE];
+    wait_event m_SpaceEvent;
+    uint8_t m_Pad3[CACHE_LINE_SIZE];
+
+    bool isAborted() const
+    {
+        return (m_Abort.load(std::memory_order_relaxed) != 0);
+    }
+
+    // Writer side. Get the cursor of the slowest active blocking reader, or the write index if
+    // there's none.
+    uint32_t slowestBlocking(const uint32_t wr)
+    {
+        const uint32_t n = m_NumReaders.load(std::memory_order_acquire);
+        uint32_t min = wr;
+
+        for (uint32_t i = 0;i < n;i++)
+        {
+            auto &r = m_Readers[i];
+
+            if ((r.policy != SLOW_READER_BLOCK) || !r.active.load(std::memory_order_acquire))
+                continue;
+
+            const uint32_t rd = r.idx.load(std::memory_order_acquire);
+
+            if ((wr - rd) > (wr - min))
+                min = rd;
+        }
+
+        return min;
+    }
+
+    // Writer side. Get the free space, refreshing the readers' cursors only when the last look
+    // shows none, and wait if there really is none.
+    uint32_t waitNotFull()
+    {
+        const uint32_t wr = m_WriteIdx.load(std::memory_order_relaxed);
+        uint32_t space = m_Capacity - (wr - m_MinCache);
+
+        if (space)
+            return space;
+
+        m_MinCache = slowestBlocking(wr);
+        space = m_Capacity - (wr - m_MinCache);
+
+        if (space)
+            return space;
+
+        m_WaitForNotFullCount.store(m_WaitForNotFullCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        while(1)
+        {
+            if (m_WaitMode == RB_WAIT_EVENT)
+            {
+                auto key = m_SpaceEvent.prepareWait();
+
+                m_MinCache = slowestBlocking(wr);
+                space = m_Capacity - (wr - m_MinCache);
+
+                if (isAborted() || space)
+                {
+                    m_SpaceEvent.cancelWait();
+                    return space;
+                }
+
+                m_SpaceEvent.wait(key);
+            }
+            else
+                timer::sleepUs(m_YieldTime);
+
+            m_MinCache = slowestBlocking(wr);
+            space = m_Capacity - (wr - m_MinCache);
+
+            if (isAborted() || space)
+                return space;
+        }
+    }
+
+    // Reader side. Wait until at least *amt* elements are there for reader *r*.
+    void waitForAmount(reader_state &r, const uint32_t amt)
+    {
+        const uint32_t rd = r.idx.load(std::memory_order_relaxed);
+
+        if ((r.writeCache - rd) >= amt)
+            return;
+
+        r.writeCache = m_WriteIdx.load(std::memory_order_acquire);
+
+        if ((r.writeCache - rd) >= amt)
+            return;
+
+        r.waitCount.store(r.waitCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        while(1)
+        {
+            if (m_WaitMode == RB_WAIT_EVENT)
+            {
+                auto key = m_DataEvent.prepareWait();
+
+                r.writeCache = m_WriteIdx.load(std::memory_order_acquire);
+
+                if (isAborted() || ((r.writeCache - rd) >= amt))
+                {
+                    m_DataEvent.cancelWait();
+                    break;
+                }
+
+                m_DataEvent.wait(key);
+            }
+            else
+                timer::sleepUs(m_YieldTime);
+
+            r.writeCache = m_WriteIdx.load(std::memory_order_acquire);
+
+            if (isAborted() || ((r.writeCache - rd) >= amt))
+                break;
+        }
+    }
+
+    // Reader side. Skip an overrun reader from *rd* to the newest data, counting what it lost.
+    void resync(reader_state &r, const uint32_t rd)
+    {
+        r.writeCache = m_WriteIdx.load(std::memory_order_acquire);
+
+        r.resyncCount.store(r.resyncCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        r.dropped.store(r.dropped.load(std::memory_order_relaxed) + (r.writeCache - rd), std::memory_order_relaxed);
+        r.idx.store(r.writeCache, std::memory_order_release);
+    }
+};
+
+}
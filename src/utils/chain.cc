@@ -2,58 +2,95 @@
 //
 // Licensed under the MIT License - see LICENSE file for details.
 
+#include <utility>
+#include <algorithm>
+#include <mutex>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
 #include "chain.h"
 
 using namespace util;
 
+// Definitions for the constants which are passed by reference, e.g., to std::min().
+constexpr size_t chain::FUSE_SPAN;
+constexpr size_t chain::MAX_TAGS;
+
 void chain::add(dsp::block<dsp::func_ff> &block, const char *name)
 {
-    m_Chain.push_back(link { ff, &block, name, block.getType() });
+    m_Chain.push_back(link { ff, &block, name, block.getType(), block.isInPlace() });
+    m_Chain.back().elementwise = block.isElementwise();
 }
 
 void chain::add(std::unique_ptr<dsp::block<dsp::func_ff>> &&block, const char *name)
 {
-    m_Chain.push_back(link { ff, block.get(), name, block->getType() });
+    m_Chain.push_back(link { ff, block.get(), name, block->getType(), block->isInPlace() });
+    m_Chain.back().elementwise = block->isElementwise();
     m_FloatBlocks.push_back(std::move(block));
 }
 
 void chain::add(dsp::block<dsp::func_fc> &block, const char *name)
 {
-    m_Chain.push_back(link { fc, &block, name, block.getType() });
+    m_Chain.push_back(link { fc, &block, name, block.getType(), block.isInPlace() });
+    m_Chain.back().elementwise = block.isElementwise();
 }
 
 void chain::add(std::unique_ptr<dsp::block<dsp::func_fc>> &&block, const char *name)
 {
-    m_Chain.push_back(link { fc, block.get(), name, block->getType() });
+    m_Chain.push_back(link { fc, block.get(), name, block->getType(), block->isInPlace() });
+    m_Chain.back().elementwise = block->isElementwise();
     m_FloatCmplxBlocks.push_back(std::move(block));
 }
 
 void chain::add(dsp::block<dsp::func_cf> &block, const char *name)
 {
-    m_Chain.push_back(link { cf, &block, name, block.getType() });
+    m_Chain.push_back(link { cf, &block, name, block.getType(), block.isInPlace() });
+    m_Chain.back().elementwise = block.isElementwise();
 }
 
 void chain::add(std::unique_ptr<dsp::block<dsp::func_cf>> &&block, const char *name)
 {
-    m_Chain.push_back(link { cf, block.get(), name, block->getType() });
+    m_Chain.push_back(link { cf, block.get(), name, block->getType(), block->isInPlace() });
+    m_Chain.back().elementwise = block->isElementwise();
     m_CmplxFloatBlocks.push_back(std::move(block));
 }
 
 void chain::add(dsp::block<dsp::func_cc> &block, const char *name)
 {
-    m_Chain.push_back(link { cc, &block, name, block.getType() });
+    m_Chain.push_back(link { cc, &block, name, block.getType(), block.isInPlace() });
+    m_Chain.back().elementwise = block.isElementwise();
 }
 
 void chain::add(std::unique_ptr<dsp::block<dsp::func_cc>> &&block, const char *name)
 {
-    m_Chain.push_back(link { cc, block.get(), name, block->getType() });
+    m_Chain.push_back(link { cc, block.get(), name, block->getType(), block->isInPlace() });
+    m_Chain.back().elementwise = block->isElementwise();
     m_CmplxBlocks.push_back(std::move(block));
 }
 
-bool chain::setup(void)
+void chain::add(chain &branch, const char *name)
 {
-    assert(m_Chain.size() > 1);
+    assert(!branch.m_Chain.empty());
+
+    // A tee passes its input through so it has the same type on both sides.
+    auto i = static_cast<interface>((branch.m_Chain[0].iface & IN_MASK) ? cc : ff);
 
+    branch.m_IsBranch = true;
+    m_Chain.push_back(link { i, nullptr, name, dsp::TYPE_OPERATOR, false, &branch });
+}
+
+void chain::add(std::unique_ptr<chain> &&branch, const char *name)
+{
+    add(*branch, name);
+    m_Branches.push_back(std::move(branch));
+}
+
+bool chain::checkLinks()
+{
     m_Trace.print(ID, "Checking chain %s [sz=%u]\n", m_Name, static_cast<uint32_t>(m_Chain.size()));
 
     for (size_t i=0; i < (m_Chain.size() - 1);i++)
@@ -67,6 +104,63 @@ bool chain::setup(void)
         }
     }
 
+    for (auto &lnk : m_Chain)
+    {
+        if (lnk.branch)
+        {
+            m_Trace.print(ID, "Checking branch at tee %s\n", lnk.name);
+
+            if (!lnk.branch->setupBranch())
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool chain::setupBranch()
+{
+    assert(m_Chain.size() > 0);
+
+    if (!checkLinks())
+        return false;
+
+    m_Trace.print(ID, "Is the first link of branch %s an operator or sink?\n", m_Name);
+
+    if ((m_Chain[0].type == dsp::TYPE_SOURCE) ||
+        ((m_Chain[0].type == dsp::TYPE_BIDIR) && (m_Chain.size() > 1)))
+    {
+        m_Trace.print(ID, "NO -- FAIL\n");
+        return false;
+    }
+
+    m_Trace.print(ID, "YES. Is the last link a sink?\n");
+
+    if (!isSinkLink(m_Chain[m_Chain.size() - 1]))
+    {
+        m_Trace.print(ID, "NO -- FAIL\n");
+        return false;
+    }
+
+    if (m_Chain[m_Chain.size() - 1].type == dsp::TYPE_BIDIR)
+        m_Chain[m_Chain.size() - 1].bimode = dsp::BIDIR_SINK;
+
+    fuseLinks();
+
+    m_IsChecked = true;
+
+    m_Trace.print(ID, "Branch %s is all good\n", m_Name);
+    return true;
+}
+
+bool chain::setup(void)
+{
+    assert(m_Chain.size() > 1);
+    assert(!m_IsBranch);
+
+    if (!checkLinks())
+        return false;
+
     m_Trace.print(ID, "All links are valid. Checking chain endpoints...\n");
 
     if ((m_Chain[0].type != dsp::TYPE_BIDIR) || (m_Chain[m_Chain.size() - 1].type != dsp::TYPE_BIDIR))
@@ -80,7 +174,7 @@ bool chain::setup(void)
 
         m_Trace.print(ID, "YES. Is the last link a sink?\n");
 
-        if ((m_Chain[m_Chain.size() - 1].type != dsp::TYPE_SINK) && (m_Chain[m_Chain.size() - 1].type != dsp::TYPE_BIDIR))
+        if (!isSinkLink(m_Chain[m_Chain.size() - 1]))
         {
             m_Trace.print(ID, "NO -- FAIL\n");
             return false;
@@ -99,81 +193,961 @@ bool chain::setup(void)
     if (m_Chain[m_Chain.size() - 1].type == dsp::TYPE_BIDIR)
         m_Chain[m_Chain.size() - 1].bimode = dsp::BIDIR_SINK;
 
+    fuseLinks();
+
+    // Size the buffers now so iteration doesn't have to.
+    planBuffers(0);
+
     m_IsChecked = true;
 
     m_Trace.print(ID, "%s is all good\n", m_Name);
     return true;
 }
 
+bool chain::setBatch(const uint32_t blocks, const uint32_t maxLatencyUs)
+{
+    if (m_IsChecked || m_IsBranch || !blocks)
+        return false;
+
+    m_Batch = blocks;
+    m_BatchLatencyUs = maxLatencyUs;
+
+    return true;
+}
+
+void chain::fuseLinks()
+{
+    m_Fused = false;
+
+    // Work backwards so each link knows how many fusible links follow it.
+    size_t run = 0;
+
+    for (size_t i=m_Chain.size();i-- > 0;)
+    {
+        auto &lnk = m_Chain[i];
+
+        if (m_Fusion && lnk.elementwise && !lnk.branch && (lnk.type == dsp::TYPE_OPERATOR))
+            run++;
+        else
+            run = 0;
+
+        lnk.fuse = run;
+    }
+
+    // A run of one is processed as usual.
+    for (size_t i=0;i < m_Chain.size();i++)
+    {
+        if (m_Chain[i].fuse > 1)
+        {
+            m_Trace.print(ID, "Fusing %u links from %s\n", static_cast<uint32_t>(m_Chain[i].fuse), m_Chain[i].name);
+            m_Fused = true;
+            i += m_Chain[i].fuse - 1;
+        }
+    }
+}
+
+void chain::planBuffers(size_t maxIn)
+{
+    m_MaxFloat = 0;
+    m_MaxCmplx = 0;
+    m_MaxScratch = 0;
+
+    // The input of the first link of a branch is the tee's input which the branch doesn't own.
+    for (auto &lnk : m_Chain)
+    {
+        if (lnk.branch)
+        {
+            lnk.branch->m_MemPolicy = m_MemPolicy;
+            lnk.branch->planBuffers(maxIn);
+            continue;
+        }
+
+        if ((lnk.type == dsp::TYPE_RESAMPLER) && (lnk.carry.capacity() < MAX_TAGS))
+            lnk.carry.reserve(MAX_TAGS);
+
+        switch(lnk.iface)
+        {
+            case ff:
+                maxIn = sizeLink<dsp::func_ff>(lnk, maxIn);
+                break;
+
+            case fc:
+                maxIn = sizeLink<dsp::func_fc>(lnk, maxIn);
+                break;
+
+            case cf:
+                maxIn = sizeLink<dsp::func_cf>(lnk, maxIn);
+                break;
+
+            case cc:
+                maxIn = sizeLink<dsp::func_cc>(lnk, maxIn);
+                break;
+        }
+
+        // A batch is made of several source blocks.
+        if (!m_IsBranch && (&lnk == &m_Chain[0]))
+            maxIn *= m_Batch;
+
+        if (lnk.iface & OUT_MASK)
+            m_MaxCmplx = std::max(m_MaxCmplx, maxIn);
+        else
+            m_MaxFloat = std::max(m_MaxFloat, maxIn);
+
+        m_Trace.print(ID, "Link %s: max output %u\n", lnk.name, static_cast<uint32_t>(maxIn));
+    }
+
+    reserveBuffers(m_Buffs);
+}
+
+void chain::reserveBuffers(link_buffers &bufs)
+{
+    for (int i=0;i < 2;i++)
+    {
+        reserveBuffer(bufs.fBuff[i], m_MaxFloat);
+        reserveBuffer(bufs.cBuff[i], m_MaxCmplx);
+    }
+
+    if (bufs.meta.tags.capacity() < MAX_TAGS)
+        bufs.meta.tags.reserve(MAX_TAGS);
+
+    if (m_MaxScratch)
+    {
+        reserveBuffer(bufs.scratchMem, m_MaxScratch);
+        util::init_aligned_ptr_on_resize<uint8_t>(bufs.scratchMem, m_MaxScratch);
+        bufs.scratch = util::workspace(util::aligned_span<uint8_t> { bufs.scratchMem });
+    }
+
+    if (m_Fused && !bufs.fSpan.capacity())
+    {
+        util::init_aligned_ptr<float>(bufs.fSpan, FUSE_SPAN);
+        util::init_aligned_ptr<rm_math::complex_f>(bufs.cSpan, FUSE_SPAN);
+    }
+}
+
 void chain::iterate()
 {
     assert(m_IsChecked);
+    assert(!m_IsBranch);
+    assert(!m_PipelineActive);
+    assert(!m_Running);
 
     dsp::rate_t rate = 0;
 
-    util::aligned_ptr<float> *pFloatIn = nullptr;
+    iterateLinks(0, m_Chain.size(), rate, m_Buffs);
+}
+
+bool chain::run(const run_params &params, const util::stop_token &token)
+{
+    assert(m_IsChecked);
+    assert(!m_IsBranch);
+
+    if (!m_IsChecked || m_IsBranch || m_PipelineActive || m_Running)
+        return false;
+
+    // Clean up after a previous run which stopped on its token.
+    if (m_RunTh.get())
+    {
+        m_RunTh->join();
+        m_RunTh.reset();
+    }
+
+    if (params.lockMemory && !lockMemory())
+    {
+        m_Trace.print(ID, "%s: can't lock memory\n", m_Name);
+        return false;
+    }
+
+    m_RunParams = params;
+    m_RunToken = token;
+    m_RunStop = util::stop_source();
+    m_RunState = 0;
+    m_RunIterations = 0;
+    m_Overruns = 0;
+    m_Underruns = 0;
+    m_Running = true;
+
+    m_RunTh = std::make_unique<std::thread>(&chain::runThread, this);
+
+    // Wait for the thread to apply its settings
+    while(!m_RunState)
+        timer::sleepUs(100);
+
+    if (m_RunState < 0)
+    {
+        m_RunTh->join();
+        m_RunTh.reset();
+        return false;
+    }
+
+    m_Trace.print(ID, "%s running\n", m_Name);
+    return true;
+}
+
+void chain::stop()
+{
+    m_RunStop.request_stop();
+
+    if (m_RunTh.get())
+    {
+        m_RunTh->join();
+        m_RunTh.reset();
+
+        m_Trace.print(ID, "%s stopped\n", m_Name);
+    }
+}
+
+// The lock is process wide so it's counted over the runs which asked for it and undone by the last.
+static std::mutex lockMutex;
+static uint32_t lockCount;
+
+bool chain::lockMemory()
+{
+#ifdef __linux__
+    std::lock_guard<std::mutex> lock { lockMutex };
+
+    if (!lockCount && mlockall(MCL_CURRENT | MCL_FUTURE))
+        return false;
+
+    ++lockCount;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void chain::unlockMemory()
+{
+#ifdef __linux__
+    std::lock_guard<std::mutex> lock { lockMutex };
+
+    if (lockCount && !--lockCount)
+        munlockall();
+#endif
+}
+
+void chain::getRunStats(run_stats &s) const
+{
+    s.iterations = m_RunIterations.load(std::memory_order_relaxed);
+    s.overruns = m_Overruns.load(std::memory_order_relaxed);
+    s.underruns = m_Underruns.load(std::memory_order_relaxed);
+}
+
+bool chain::applyRunParams()
+{
+#ifdef __linux__
+    if (m_RunParams.cpu >= 0)
+    {
+        cpu_set_t cpus;
+
+        CPU_ZERO(&cpus);
+        CPU_SET(m_RunParams.cpu, &cpus);
+
+        if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))
+        {
+            m_Trace.print(ID, "%s: can't pin to CPU %d\n", m_Name, m_RunParams.cpu);
+            return false;
+        }
+    }
+
+    if (m_RunParams.priority > 0)
+    {
+        sched_param sp { };
+        sp.sched_priority = m_RunParams.priority;
+
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp))
+        {
+            m_Trace.print(ID, "%s: can't set SCHED_FIFO priority %d\n", m_Name, m_RunParams.priority);
+            return false;
+        }
+    }
+
+    return true;
+#else
+    if ((m_RunParams.cpu >= 0) || (m_RunParams.priority > 0))
+    {
+        m_Trace.print(ID, "%s: thread settings not supported\n", m_Name);
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+void chain::checkRingBuffers(util::ring_buffer_diag &source, util::ring_buffer_diag &sink)
+{
+    util::ring_buffer_diag d;
+
+    // The counts only go up so the difference from the last check is what happened since.
+    if (m_RunParams.sourceDiag)
+    {
+        m_RunParams.sourceDiag(d);
+
+        if (d.fullCount != source.fullCount)
+        {
+            m_Trace.print(ID, "%s: %u overrun(s)\n", m_Name, d.fullCount - source.fullCount);
+            m_Overruns.fetch_add(d.fullCount - source.fullCount, std::memory_order_relaxed);
+        }
+
+        const uint64_t lost = (d.droppedNewest - source.droppedNewest) + (d.overwritten - source.overwritten);
+
+        if (lost)
+        {
+            m_Trace.print(ID, "%s: %lu sample(s) lost\n", m_Name, static_cast<unsigned long>(lost));
+            m_Overruns.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        source = d;
+    }
+
+    if (m_RunParams.sinkDiag)
+    {
+        m_RunParams.sinkDiag(d);
+
+        if (d.emptyCount != sink.emptyCount)
+        {
+            m_Trace.print(ID, "%s: %u underrun(s)\n", m_Name, d.emptyCount - sink.emptyCount);
+            m_Underruns.fetch_add(d.emptyCount - sink.emptyCount, std::memory_order_relaxed);
+        }
+
+        sink = d;
+    }
+}
+
+void chain::runThread()
+{
+    if (!applyRunParams())
+    {
+        if (m_RunParams.lockMemory)
+            unlockMemory();
+
+        m_Running = false;
+        m_RunState = -1;
+        return;
+    }
+
+    // Anything counted before the run started doesn't count.
+    util::ring_buffer_diag source { };
+    util::ring_buffer_diag sink { };
+
+    if (m_RunParams.sourceDiag)
+        m_RunParams.sourceDiag(source);
+
+    if (m_RunParams.sinkDiag)
+        m_RunParams.sinkDiag(sink);
+
+    m_RunState = 1;
+
+    auto tick = timer::StartTimer();
+
+    while(!m_RunToken.stop_requested() && !m_RunStop.stop_requested())
+    {
+        dsp::rate_t rate = 0;
+
+        iterateLinks(0, m_Chain.size(), rate, m_Buffs);
+        m_RunIterations.store(m_RunIterations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        if (timer::EndTimer(tick) >= m_RunParams.reportPeriod)
+        {
+            checkRingBuffers(source, sink);
+            tick = timer::StartTimer();
+        }
+    }
+
+    checkRingBuffers(source, sink);
+
+    if (m_RunParams.lockMemory)
+        unlockMemory();
+
+    m_Running = false;
+}
+
+void chain::iterateLinks(const size_t first, const size_t last, dsp::rate_t &rate, link_buffers &bufs,
+                            const util::aligned_ptr<float> *fIn,
+                            const util::aligned_ptr<rm_math::complex_f> *cIn)
+{
+    const util::aligned_ptr<float> *pFloatIn = nullptr;
     util::aligned_ptr<float> *pFloatOut = nullptr;
 
-    util::aligned_ptr<rm_math::complex_f> *pCmplxIn = nullptr;
+    const util::aligned_ptr<rm_math::complex_f> *pCmplxIn = nullptr;
     util::aligned_ptr<rm_math::complex_f> *pCmplxOut = nullptr;
 
-    for (size_t i=0; i < m_Chain.size();i++)
+    size_t i = first;
+
+    // A new block starts at the source without tags.
+    if ((first == 0) && !m_IsBranch)
+        bufs.meta.tags.clear();
+
+    if ((first == 0) && (m_Batch > 1) && !m_IsBranch)
+    {
+        iterateBatch(rate, bufs);
+        i++;
+    }
+
+    for (;i < last;i++)
     {
+        if (m_Chain[i].branch)
+        {
+            m_LinkTrace.print(ID, "Tee %s\n", m_Chain[i].name);
+
+            // Each branch gets its own copy of the rate and the tee's input block by reference.
+            // The block passes through the tee untouched.
+            dsp::rate_t branchRate = rate;
+            auto *br = m_Chain[i].branch;
+
+            br->m_Buffs.meta.stamp = bufs.meta.stamp;
+            br->m_Buffs.meta.tags = bufs.meta.tags;
+
+            if (m_Chain[i].iface == cc)
+                br->iterateLinks(0, br->m_Chain.size(), branchRate, br->m_Buffs, nullptr,
+                                    cIn ? cIn : &bufs.cBuff[bufs.cIdx]);
+            else
+                br->iterateLinks(0, br->m_Chain.size(), branchRate, br->m_Buffs,
+                                    fIn ? fIn : &bufs.fBuff[bufs.fIdx]);
+
+            continue;
+        }
+
+        // A run of element-wise links, cut short at the end of a pipeline stage
+        size_t fused = std::min(m_Chain[i].fuse, last - i);
+
+        if (fused > 1)
+        {
+            iterateFused(i, fused, rate, bufs, fIn, cIn);
+
+            i += fused - 1;
+            fIn = nullptr;
+            cIn = nullptr;
+            continue;
+        }
+
         switch(m_Chain[i].iface)
         {
             case ff:
                 m_LinkTrace.print(ID, "F -> F\n");
 
-                pFloatIn = &m_fBuff[m_FIdx];
-                m_FIdx = (m_FIdx + 1) & 1;
-                pFloatOut = &m_fBuff[m_FIdx];
-                handleLink<dsp::func_ff, float, float>(m_Chain[i], rate, *pFloatIn, *pFloatOut);
+                // An in-place link works on the current buffer, unless it's an external input
+                // which is shared with other branches.
+                if (m_Chain[i].inplace && !fIn)
+                {
+                    pFloatOut = &bufs.fBuff[bufs.fIdx];
+                    handleLink<dsp::func_ff, float, float>(m_Chain[i], rate, *pFloatOut, *pFloatOut, bufs);
+                    break;
+                }
+
+                pFloatIn = fIn ? fIn : &bufs.fBuff[bufs.fIdx];
+                bufs.fIdx = (bufs.fIdx + 1) & 1;
+                pFloatOut = &bufs.fBuff[bufs.fIdx];
+                handleLink<dsp::func_ff, float, float>(m_Chain[i], rate, *pFloatIn, *pFloatOut, bufs);
                 break;
 
             case fc:
                 m_LinkTrace.print(ID, "F -> C\n");
 
-                pFloatIn = &m_fBuff[m_FIdx];
-                pCmplxOut = &m_cBuff[m_CIdx];
-                handleLink<dsp::func_fc, float, rm_math::complex_f>(m_Chain[i], rate, *pFloatIn, *pCmplxOut);
+                pFloatIn = fIn ? fIn : &bufs.fBuff[bufs.fIdx];
+                pCmplxOut = &bufs.cBuff[bufs.cIdx];
+                handleLink<dsp::func_fc, float, rm_math::complex_f>(m_Chain[i], rate, *pFloatIn, *pCmplxOut, bufs);
                 break;
 
             case cf:
                 m_LinkTrace.print(ID, "C -> F\n");
 
-                pCmplxIn = &m_cBuff[m_CIdx];
-                pFloatOut = &m_fBuff[m_FIdx];
-                handleLink<dsp::func_cf, rm_math::complex_f, float>(m_Chain[i], rate, *pCmplxIn, *pFloatOut);
+                pCmplxIn = cIn ? cIn : &bufs.cBuff[bufs.cIdx];
+                pFloatOut = &bufs.fBuff[bufs.fIdx];
+                handleLink<dsp::func_cf, rm_math::complex_f, float>(m_Chain[i], rate, *pCmplxIn, *pFloatOut, bufs);
                 break;
 
             case cc:
                 m_LinkTrace.print(ID, "C -> C\n");
 
-                pCmplxIn = &m_cBuff[m_CIdx];
-                m_CIdx = (m_CIdx + 1) & 1;
-                pCmplxOut = &m_cBuff[m_CIdx];
-                handleLink<dsp::func_cc, rm_math::complex_f, rm_math::complex_f>(m_Chain[i], rate, *pCmplxIn, *pCmplxOut);
+                if (m_Chain[i].inplace && !cIn)
+                {
+                    pCmplxOut = &bufs.cBuff[bufs.cIdx];
+                    handleLink<dsp::func_cc, rm_math::complex_f, rm_math::complex_f>(m_Chain[i], rate, *pCmplxOut, *pCmplxOut, bufs);
+                    break;
+                }
+
+                pCmplxIn = cIn ? cIn : &bufs.cBuff[bufs.cIdx];
+                bufs.cIdx = (bufs.cIdx + 1) & 1;
+                pCmplxOut = &bufs.cBuff[bufs.cIdx];
+                handleLink<dsp::func_cc, rm_math::complex_f, rm_math::complex_f>(m_Chain[i], rate, *pCmplxIn, *pCmplxOut, bufs);
                 break;
 
             default:
                 assert(1);
         }
+
+        // The external input only applies until the first block has consumed it; tees pass it through.
+        fIn = nullptr;
+        cIn = nullptr;
+    }
+
+    if (last == m_Chain.size())
+        m_Latency.stop(bufs.meta.stamp, 0, 0);
+}
+
+void chain::iterateBatch(dsp::rate_t &rate, link_buffers &bufs)
+{
+    auto &src = m_Chain[0];
+
+    m_LinkTrace.print(ID, "Batch of %s\n", src.name);
+
+    // The source's input is unused. Each block goes to the buffer which isn't the batch and gets
+    // appended to the batch, which ends up where a single block would have.
+    switch(src.iface)
+    {
+        case ff:
+            bufs.fIdx = (bufs.fIdx + 1) & 1;
+            gatherSource<dsp::func_ff, float, float>(src, rate, bufs.fBuff[bufs.fIdx ^ 1], bufs.fBuff[bufs.fIdx ^ 1], bufs.fBuff[bufs.fIdx], bufs);
+            break;
+
+        case fc:
+            gatherSource<dsp::func_fc, float, rm_math::complex_f>(src, rate, bufs.fBuff[bufs.fIdx], bufs.cBuff[bufs.cIdx ^ 1], bufs.cBuff[bufs.cIdx], bufs);
+            break;
+
+        case cf:
+            gatherSource<dsp::func_cf, rm_math::complex_f, float>(src, rate, bufs.cBuff[bufs.cIdx], bufs.fBuff[bufs.fIdx ^ 1], bufs.fBuff[bufs.fIdx], bufs);
+            break;
+
+        case cc:
+            bufs.cIdx = (bufs.cIdx + 1) & 1;
+            gatherSource<dsp::func_cc, rm_math::complex_f, rm_math::complex_f>(src, rate, bufs.cBuff[bufs.cIdx ^ 1], bufs.cBuff[bufs.cIdx ^ 1], bufs.cBuff[bufs.cIdx], bufs);
+            break;
+    }
+}
+
+void chain::iterateFused(const size_t first, const size_t n, dsp::rate_t &rate, link_buffers &bufs,
+                            const util::aligned_ptr<float> *fIn,
+                            const util::aligned_ptr<rm_math::complex_f> *cIn)
+{
+    auto &head = m_Chain[first];
+
+    m_LinkTrace.print(ID, "Fused links %s + %u\n", head.name, static_cast<uint32_t>(n - 1));
+
+    // The input is wherever the first link would have read it from.
+    const bool cmplxIn = (head.iface & IN_MASK);
+    const util::aligned_ptr<float> *fSrc = fIn ? fIn : &bufs.fBuff[bufs.fIdx];
+    const util::aligned_ptr<rm_math::complex_f> *cSrc = cIn ? cIn : &bufs.cBuff[bufs.cIdx];
+    const size_t size = cmplxIn ? cSrc->size() : fSrc->size();
+
+    // The output goes wherever the last link would have written it had the links run one by one,
+    // so the links which follow find it as usual.
+    bool external = (fIn || cIn);
+
+    for (size_t i=first;i < first + n;i++)
+    {
+        auto &lnk = m_Chain[i];
+        auto blkType = lnk.iface;
+
+        if ((blkType == ff) && (!lnk.inplace || external))
+            bufs.fIdx = (bufs.fIdx + 1) & 1;
+        else if ((blkType == cc) && (!lnk.inplace || external))
+            bufs.cIdx = (bufs.cIdx + 1) & 1;
+
+        external = false;
+        lnk.fusedNs = 0;
+
+        // Element-wise links are operators so the rate and tags pass through.
+        switch(blkType)
+        {
+            case ff: prepareFused<dsp::func_ff>(lnk, rate, bufs); break;
+            case fc: prepareFused<dsp::func_fc>(lnk, rate, bufs); break;
+            case cf: prepareFused<dsp::func_cf>(lnk, rate, bufs); break;
+            case cc: prepareFused<dsp::func_cc>(lnk, rate, bufs); break;
+        }
+    }
+
+    const bool cmplxOut = (m_Chain[first + n - 1].iface & OUT_MASK);
+
+    auto allocs = util::aligned_ptr_allocs();
+    auto mark = head.prof.start();
+
+    void *out;
+
+    if (cmplxOut)
+    {
+        util::init_aligned_ptr_on_resize<rm_math::complex_f>(bufs.cBuff[bufs.cIdx], size);
+        out = &bufs.cBuff[bufs.cIdx][0];
+    }
+    else
+    {
+        util::init_aligned_ptr_on_resize<float>(bufs.fBuff[bufs.fIdx], size);
+        out = &bufs.fBuff[bufs.fIdx][0];
+    }
+
+    // Run every link over one span before moving on to the next span. The spans in between links
+    // are processed in place where the type doesn't change.
+    for (size_t offset=0;offset < size;offset += FUSE_SPAN)
+    {
+        const size_t len = std::min(FUSE_SPAN, size - offset);
+        const void *src = cmplxIn ? static_cast<const void *>(cSrc->data() + offset)
+                                  : static_cast<const void *>(fSrc->data() + offset);
+
+        for (size_t i=first;i < first + n;i++)
+        {
+            auto &lnk = m_Chain[i];
+            const bool toCmplx = (lnk.iface & OUT_MASK);
+            void *dst;
+
+            if (i == first + n - 1)
+                dst = toCmplx ? static_cast<void *>(static_cast<rm_math::complex_f *>(out) + offset)
+                              : static_cast<void *>(static_cast<float *>(out) + offset);
+            else
+                dst = toCmplx ? static_cast<void *>(&bufs.cSpan[0]) : static_cast<void *>(&bufs.fSpan[0]);
+
+            switch(lnk.iface)
+            {
+                case ff: callKernel<dsp::func_ff>(lnk, src, dst, len); break;
+                case fc: callKernel<dsp::func_fc>(lnk, src, dst, len); break;
+                case cf: callKernel<dsp::func_cf>(lnk, src, dst, len); break;
+                case cc: callKernel<dsp::func_cc>(lnk, src, dst, len); break;
+            }
+
+            lnk.fusedNs += lnk.prof.lap(mark);
+            src = dst;
+        }
+    }
+
+    // Each link gets the time of its own spans and every fused link is done with the block at the
+    // same time.
+    for (size_t i=first;i < first + n;i++)
+    {
+        m_Chain[i].prof.record(m_Chain[i].fusedNs, size, size);
+        m_Chain[i].lat.stop(bufs.meta.stamp, 0, 0);
+    }
+
+    // Same as handleLink()
+    allocs = util::aligned_ptr_allocs() - allocs;
+
+    if (head.primed && allocs)
+    {
+        m_Trace.print(ID, "Fused link %s allocated %u buffer(s) in steady state\n", head.name, static_cast<uint32_t>(allocs));
+        head.allocs += allocs;
+        assert(!ALLOC_CHECK);
+    }
+
+    head.primed = true;
+}
+
+bool chain::setStages(const std::vector<size_t> &firstLinks, const uint32_t depth, const uint32_t yieldTime)
+{
+    assert(m_IsChecked);
+    assert(!m_PipelineActive);
+    assert((depth > 0) && !(depth & (depth - 1)));
+
+    if (!m_IsChecked || m_IsBranch || m_PipelineActive)
+        return false;
+
+    std::vector<size_t> firsts { 0 };
+
+    if (firstLinks.empty())
+    {
+        for (size_t i=1;i < m_Chain.size();i++)
+            firsts.push_back(i);
+    }
+    else
+    {
+        for (auto idx : firstLinks)
+        {
+            if ((idx <= firsts.back()) || (idx >= m_Chain.size()))
+            {
+                m_Trace.print(ID, "Invalid stage start at link %u. ABORT\n", static_cast<uint32_t>(idx));
+                return false;
+            }
+
+            firsts.push_back(idx);
+        }
+    }
+
+    if ((firsts.size() > 1) && (m_Chain[0].block == m_Chain[m_Chain.size() - 1].block))
+    {
+        m_Trace.print(ID, "A bidirectional endpoint cannot be split across stages. ABORT\n");
+        return false;
+    }
+
+    m_Stages.clear();
+    m_StageQueues.clear();
+
+    m_Stages.reserve(firsts.size());
+
+    for (size_t i=0;i < firsts.size();i++)
+    {
+        size_t last = ((i + 1) < firsts.size()) ? firsts[i + 1] : m_Chain.size();
+
+        m_Trace.print(ID, "Stage %u: %s .. %s\n", static_cast<uint32_t>(i), m_Chain[firsts[i]].name, m_Chain[last - 1].name);
+        m_Stages.push_back(stage { firsts[i], last });
+    }
+
+    for (auto &stg : m_Stages)
+        reserveBuffers(stg.bufs);
+
+    // Connect each stage to the next one
+    for (size_t i=1;i < m_Stages.size();i++)
+    {
+        m_StageQueues.push_back(std::make_unique<stage_queue>(depth));
+        m_Stages[i - 1].out = m_StageQueues.back().get();
+        m_Stages[i].in = m_StageQueues.back().get();
+
+        // The slot buffers are swapped with the stage buffers so size them the same. Going
+        // around the queue once reaches every slot.
+        auto *q = m_StageQueues.back().get();
+
+        for (uint32_t j=0;j < depth;j++)
+        {
+            auto *blk = q->back();
+
+            reserveBuffer(blk->fBuff, m_MaxFloat);
+            reserveBuffer(blk->cBuff, m_MaxCmplx);
+            blk->meta.tags.reserve(MAX_TAGS);
+            q->push();
+        }
+
+        while(q->front())
+            q->pop();
+    }
+
+    m_StageYieldTime = yieldTime;
+
+    return true;
+}
+
+bool chain::startPipeline()
+{
+    assert(m_IsChecked);
+
+    if (m_Stages.empty() || m_PipelineActive || m_Running)
+        return false;
+
+    m_PipelineActive = true;
+    m_StagesBound = 0;
+
+    for (auto &stg : m_Stages)
+        stg.th = std::make_unique<std::thread>(&chain::stageThread, this, std::ref(stg));
+
+    m_Trace.print(ID, "%s pipeline started with %u stages\n", m_Name, static_cast<uint32_t>(m_Stages.size()));
+    return true;
+}
+
+void chain::stopPipeline()
+{
+    if (!m_PipelineActive)
+        return;
+
+    m_PipelineActive = false;
+
+    for (auto &stg : m_Stages)
+    {
+        if (stg.th.get())
+            stg.th->join();
+
+        stg.th.reset();
+    }
+
+    // Drop anything left in the queues so a restart begins with a clean pipeline.
+    for (auto &q : m_StageQueues)
+    {
+        while(q->front())
+            q->pop();
+    }
+
+    m_Trace.print(ID, "%s pipeline stopped\n", m_Name);
+}
+
+void chain::stageThread(stage &stg)
+{
+    // The type of block handed over at each end of the stage
+    const bool cmplxIn = (m_Chain[stg.first].iface & IN_MASK);
+    const bool cmplxOut = (m_Chain[stg.last - 1].iface & OUT_MASK);
+
+    // Bind before any stage hands a block on, while the queues aren't being touched.
+    bindStage(stg);
+    ++m_StagesBound;
+
+    while(m_PipelineActive && (m_StagesBound.load() < m_Stages.size()))
+        timer::sleepUs(m_StageYieldTime);
+
+    while(m_PipelineActive)
+    {
+        dsp::rate_t rate = 0;
+
+        if (stg.in)
+        {
+            auto *blk = stg.in->front();
+
+            if (!blk)
+            {
+                timer::sleepUs(m_StageYieldTime);
+                continue;
+            }
+
+            // Swap the queued block in as the stage's input; the stage's old buffer goes back
+            // with the slot to be reused by the previous stage.
+            if (cmplxIn)
+                std::swap(blk->cBuff, stg.bufs.cBuff[stg.bufs.cIdx]);
+            else
+                std::swap(blk->fBuff, stg.bufs.fBuff[stg.bufs.fIdx]);
+
+            rate = blk->rate;
+            std::swap(blk->meta, stg.bufs.meta);
+            stg.in->pop();
+        }
+
+        iterateLinks(stg.first, stg.last, rate, stg.bufs);
+
+        if (stg.out)
+        {
+            stage_block *blk;
+
+            while(!(blk = stg.out->back()))
+            {
+                if (!m_PipelineActive)
+                    return;
+
+                timer::sleepUs(m_StageYieldTime);
+            }
+
+            if (cmplxOut)
+                std::swap(blk->cBuff, stg.bufs.cBuff[stg.bufs.cIdx]);
+            else
+                std::swap(blk->fBuff, stg.bufs.fBuff[stg.bufs.fIdx]);
+
+            blk->rate = rate;
+            std::swap(blk->meta, stg.bufs.meta);
+            stg.out->push();
+        }
+    }
+}
+
+void chain::bindStage(stage &stg)
+{
+    if (!(m_MemPolicy & util::MEM_NUMA_LOCAL))
+        return;
+
+    for (int i=0;i < 2;i++)
+    {
+        bindBuffer(stg.bufs.fBuff[i]);
+        bindBuffer(stg.bufs.cBuff[i]);
+    }
+
+    bindBuffer(stg.bufs.scratchMem);
+
+    // Filling the empty queue reaches every slot, as in setStages(). No stage runs yet so
+    // nothing else touches it.
+    if (stg.in)
+    {
+        stage_block *blk;
+
+        while((blk = stg.in->back()))
+        {
+            bindBuffer(blk->fBuff);
+            bindBuffer(blk->cBuff);
+            stg.in->push();
+        }
+
+        while(stg.in->front())
+            stg.in->pop();
+    }
+}
+
+void chain::stats(std::vector<link_stats> &s) const
+{
+    if (!PROFILING && !LATENCY)
+        return;
+
+    for (auto &lnk : m_Chain)
+    {
+        if (lnk.branch)
+            continue;
+
+        link_stats ls { m_Name, lnk.name, { }, { } };
+        lnk.prof.get(ls.prof);
+        lnk.lat.get(ls.latency);
+        s.push_back(ls);
+    }
+
+    for (auto &lnk : m_Chain)
+    {
+        if (lnk.branch)
+            lnk.branch->stats(s);
     }
 }
 
+void chain::latencyStats(std::vector<latency_stats> &s) const
+{
+    if (!LATENCY)
+        return;
+
+    latency_stats ls { m_Name, { } };
+    m_Latency.get(ls.latency);
+    s.push_back(ls);
+
+    for (auto &lnk : m_Chain)
+    {
+        if (lnk.branch)
+            lnk.branch->latencyStats(s);
+    }
+}
+
+void chain::resetStats()
+{
+    m_Latency.reset();
+
+    for (auto &lnk : m_Chain)
+    {
+        lnk.prof.reset();
+        lnk.lat.reset();
+
+        if (lnk.branch)
+            lnk.branch->resetStats();
+    }
+}
+
+uint64_t chain::steadyStateAllocs() const
+{
+    uint64_t allocs = 0;
+
+    for (auto &lnk : m_Chain)
+    {
+        allocs += lnk.allocs;
+
+        if (lnk.branch)
+            allocs += lnk.branch->steadyStateAllocs();
+    }
+
+    return allocs;
+}
+
 void chain::clear()
 {
+    stop();
+    stopPipeline();
+
+    m_Stages.clear();
+    m_StageQueues.clear();
+
     m_Chain.clear();
 
     m_FloatBlocks.clear();
     m_FloatCmplxBlocks.clear();
     m_CmplxFloatBlocks.clear();
     m_CmplxBlocks.clear();
+    m_Branches.clear();
+
+    m_Buffs.fBuff[0].clear();
+    m_Buffs.fBuff[1].clear();
+    m_Buffs.cBuff[0].clear();
+    m_Buffs.cBuff[1].clear();
+    m_Buffs.fSpan.clear();
+    m_Buffs.cSpan.clear();
+    m_Buffs.scratchMem.clear();
+    m_Buffs.scratch = util::workspace();
+
+    m_MaxFloat = 0;
+    m_MaxCmplx = 0;
+    m_MaxScratch = 0;
 
-    m_fBuff[0].clear();
-    m_fBuff[1].clear();
-    m_cBuff[0].clear();
-    m_cBuff[1].clear();
+    // A rebuilt chain starts a new stream.
+    m_SourceTags = false;
+    m_SourceIndex = 0;
 
     m_IsChecked = false;
 }
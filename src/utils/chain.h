@@ -5,12 +5,23 @@
 #pragma once
 
 #include <vector>
+#include <cstring>
 #include <typeinfo>
 #include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
 
+#include "radiomon-config.h"
 #include "block.h"
 #include "trace.h"
+#include "timer.h"
 #include "aligned-ptr.h"
+#include "workspace.h"
+#include "spsc-queue.h"
+#include "profiler.h"
+#include "ring-buffer.h"
+#include "stop-token.h"
 
 namespace util {
 
@@ -20,7 +31,7 @@ namespace util {
  * of the chain to the other end. The data originates from a *source* block (e.g., a driver
  * for an SDR) and gets passed through each block in the chain until it reaches the *sink*
  * block at the end. In the context of a chain, each block is a *link* and there are
- * currently five types of links:
+ * currently six types of links:
  *
  * * **Operator**  Most links are of this type. They operate on each block of data before
  *     passing it on to the next link.
@@ -31,6 +42,8 @@ namespace util {
  * * **Resampler**  This is an operator which changes the sampling rate, e.g., a
  *     rational resampler. These links are read by the chain logic to update the sampling rate which
  *     is then given to all links that follow.
+ * * **Tee**  A fan-out link which hands the current block to another chain, a *branch*, and then
+ *     passes the same block on to the next link. See below.
  *
  * An example of a chain would be, say, an FSK demodulator.
  *
@@ -41,24 +54,227 @@ namespace util {
  * * **Pointers** where a *std::unique_ptr* containing the block is passed in. This is the
  *   *add-and-forget* method which gives ownership of the pointer to the chain instance. It will be
  *   destroyed when the chain is destroyed.
+ *
+ * \note A chain can be iterated in one of two ways:
+ * * **Serial** where the application calls *iterate()* and every link runs on the caller's thread.
+ * * **Pipelined** where the links are split into *stages* with *setStages()* and each stage runs
+ *   on its own worker thread once *startPipeline()* is called. Consecutive stages are connected
+ *   with bounded SPSC queues which hand the sample blocks (and the sampling rate) from one stage
+ *   to the next without copying. While one stage works on a block, the previous stage is already
+ *   working on the next one, so a heavy chain is spread across several cores.
+ *
+ * \note Chains can be shaped as a tree by adding *branches*. A branch is a chain without a source
+ * which is added to another chain as a tee link. When the tee link is reached, the branch is
+ * iterated with the tee's input block as the input of its first link. The block is passed by
+ * *const* reference so every branch sees the same immutable block and nothing is copied, no matter
+ * how many branches there are. Consecutive tee links fan one block out to several branches, e.g., one
+ * SDR source feeding a recorder, a spectrum display and two demodulators. Each branch starts with
+ * a copy of the sampling rate at the tee, so resamplers in one branch only affect the links downstream
+ * of them in that branch. Branches may contain tee links of their own. A branch is iterated by whichever
+ * thread iterates the tee link so it becomes part of that stage in a pipelined chain.
+ *
+ * \note Rather than calling *iterate()* in a loop of its own, an application can have the chain do it
+ * with *run()*. The chain then iterates on a dedicated thread which can be pinned to a CPU, run with
+ * SCHED_FIFO priority and have the process memory locked, which keeps scheduler jitter on a loaded
+ * machine from causing overruns at the source or underruns at the sink. The loop stops when the given
+ * *stop_token* is triggered or *stop()* is called. The ring buffers feeding the source and fed by the
+ * sink can be watched (see *run_params*) and their diagnostics are turned into overrun and underrun
+ * counts (see *getRunStats()*).
+ *
+ * \note Per-link profiling (call counts, processing times and sample counts) is compiled in with the
+ * *chain_profiling* build option (*meson configure -Dchain_profiling=true*), which defines
+ * *CHAIN_PROFILING* in *radiomon-config.h* so every file of the build sees the same chain. The results
+ * are read with *stats()*. Without it the profiling code compiles away.
+ *
+ * \note End-to-end latency tracing is compiled in with the *chain_latency* build option (*CHAIN_LATENCY*
+ * in *radiomon-config.h*, like *CHAIN_PROFILING*). Each block is stamped when the source outputs it,
+ * or with the time the source captured it if the source knows (see *dsp::block::getCaptureTime()*),
+ * e.g., the audio endpoint dates its blocks back to when its read thread got them from the device.
+ * The stamp travels with the block through every link, pipeline stage, batch (the stamp of its first
+ * source block) and branch. After each link the time since the stamp is added to a histogram of that
+ * link, and after the last link to a histogram of the chain, which gives the end-to-end latency. The
+ * results are read with *stats()* and *latencyStats()* and are meant for tuning ring buffer and block
+ * sizes against a latency budget.
+ *
+ * \note Blocks may carry *tags* (see *dsp::stream_tag*), e.g., the absolute sample index, capture
+ * time or center frequency of a sample, which ride alongside the samples through every link, pipeline
+ * stage, batch and branch. Sources attach them and any later block can read them (see
+ * *dsp::block::getTags()*); after a resampler each tag moves to the output sample the tagged input
+ * reaches (see *dsp::block::getOutputOffset()*), held over to the next block if this one ends first,
+ * and sample indices are rescaled by the rate ratio. The chain can tag each source block with its
+ * sample index and capture time itself (see *setSourceTags()*). The tag lists are sized at setup to
+ * *MAX_TAGS*, so tags never allocate, and a block without tags costs next to nothing.
+ *
+ * \note Blocks which can process in place (see *dsp::block::isInPlace()*), e.g., gains and filters,
+ * are given the same buffer as their input and output rather than the next ping-pong buffer. A run of
+ * such links keeps working on one buffer which stays in the cache.
+ *
+ * \note Consecutive element-wise operators (see *dsp::block::isElementwise()*), e.g., gains and
+ * *complex_float*, are *fused* by *setup()*. Rather than each of them sweeping the whole block through
+ * memory, the fused links are run one after the other on a span of *FUSE_SPAN* samples which stays in
+ * the L1 cache, then on the next span, and so on. The results are the same; chains at high sample rates
+ * spend less time waiting on memory. Each fused link is profiled as one call per block, timed over its
+ * own spans, so the profile of a link doesn't include the memory traffic fusion saves. Fusion can be
+ * turned off with *setFusion()*, e.g., to see how much it saves.
+ *
+ * \note With small source blocks, e.g., 256 sample audio blocks, the fixed cost of calling each link
+ * can outweigh the processing. *setBatch()* has each iteration call the source several times and
+ * concatenate its blocks so the rest of the links run once over the whole batch. This trades latency
+ * for throughput; a latency cap limits the batch to the source blocks which fit within it.
+ *
+ * \note *setup()* sizes every buffer the chain passes between links, including those of the
+ * branches and, once *setStages()* is called, the pipeline stages. It starts with the block size of
+ * the source and works down the chain using each resampler's rate ratio, and gives each block the
+ * largest input it will see so blocks with internal buffers can size them too. As long as the
+ * source never outputs more than it reported, *iterate()* does not allocate. If the source can't
+ * report its block size at setup (e.g., the device isn't configured yet) the buffers are sized by the
+ * first iteration instead. Buffers allocated by a link after its first call are counted (see
+ * *steadyStateAllocs()*) and, with the *chain_alloc_check* build option (*CHAIN_ALLOC_CHECK*),
+ * trigger an assert.
 */
 
 class chain
 {
 public:
 
+    //! **true** if per-link profiling is compiled in.
+#ifdef CHAIN_PROFILING
+    static constexpr bool PROFILING = true;
+#else
+    static constexpr bool PROFILING = false;
+#endif
+
+    //! **true** if latency tracing is compiled in.
+#ifdef CHAIN_LATENCY
+    static constexpr bool LATENCY = true;
+#else
+    static constexpr bool LATENCY = false;
+#endif
+
+    //! **true** if allocations in steady state trigger an assert.
+#ifdef CHAIN_ALLOC_CHECK
+    static constexpr bool ALLOC_CHECK = true;
+#else
+    static constexpr bool ALLOC_CHECK = false;
+#endif
+
+    //! The number of samples fused links process at a time. This keeps the spans of the widest
+    //! (complex) samples passed between the links well within the L1 cache.
+    static constexpr size_t FUSE_SPAN = 256;
+
+    //! The most tags a block can carry. Tags attached beyond this are dropped.
+    static constexpr size_t MAX_TAGS = 32;
+
+    //! Profiling results of a link returned by *stats()*.
+    struct link_stats
+    {
+        //! The name of the chain (or branch) the link is in.
+        const char *chain;
+
+        //! The name of the link.
+        const char *name;
+
+        //! The profiling results. The input samples of sources and the output samples of sinks are not counted.
+        util::profile_stats prof;
+
+        //! The time from the source stamp of each block to the end of this link. Only the call
+        //! counts and times are used. Only set if latency tracing is compiled in (see *CHAIN_LATENCY*).
+        util::profile_stats latency;
+    };
+
+    //! End-to-end latency of a chain or branch returned by *latencyStats()*.
+    struct latency_stats
+    {
+        //! The name of the chain (or branch).
+        const char *chain;
+
+        //! The time from the source stamp of each block to the end of the last link. Only the call
+        //! counts and times are used.
+        util::profile_stats latency;
+    };
+
+    //! Parameters for *run()*.
+    struct run_params
+    {
+        run_params() : cpu { -1 }, priority { 0 }, lockMemory { false }, reportPeriod { 1000 } { }
+
+        //! The CPU to pin the run thread to or -1 to leave it to the scheduler.
+        int cpu;
+
+        //! The SCHED_FIFO priority (1 - 99) of the run thread or zero for the default scheduler.
+        //! This usually needs privileges, e.g., CAP_SYS_NICE or an *rtprio* limit.
+        int priority;
+
+        //! Lock the current and future pages of the process into memory (*mlockall()*) so the chain
+        //! doesn't stall on page faults. They're unlocked when the run ends, or fails to start, unless
+        //! another chain's run still needs them.
+        bool lockMemory;
+
+        //! Time in milliseconds between checks of the watched ring buffers.
+        uint32_t reportPeriod;
+
+        //! Watch the ring buffer the source reads from. Each time its producer finds it full, the
+        //! chain fell behind and it's counted as an overrun; so is each check which finds samples
+        //! dropped or overwritten under a full policy other than *RB_FULL_BLOCK*.
+        template<typename T>
+        void watchSource(util::ring_buffer<T> &rb)
+        {
+            sourceDiag = std::bind(&util::ring_buffer<T>::diagnostics, &rb, std::placeholders::_1);
+        }
+
+        //! Watch the ring buffer the sink writes to. Each time its consumer finds it short, the
+        //! chain fell behind and it's counted as an underrun.
+        template<typename T>
+        void watchSink(util::ring_buffer<T> &rb)
+        {
+            sinkDiag = std::bind(&util::ring_buffer<T>::diagnostics, &rb, std::placeholders::_1);
+        }
+
+        //! \cond
+        std::function<void(util::ring_buffer_diag&)> sourceDiag;
+        std::function<void(util::ring_buffer_diag&)> sinkDiag;
+        //! \endcond
+    };
+
+    //! Statistics of the current (or last) *run()*.
+    struct run_stats
+    {
+        //! The number of iterations.
+        uint64_t iterations;
+
+        //! The number of overruns seen at the source.
+        uint32_t overruns;
+
+        //! The number of underruns seen at the sink.
+        uint32_t underruns;
+    };
+
     //! Create an instance of a chain. The name is set to a default value.
-    chain() : m_IsChecked { false }, m_FIdx { 0 }, m_CIdx { 0 }
+    chain() : m_IsChecked { false }, m_IsBranch { false }, m_Fusion { true }, m_Fused { false },
+                m_SourceTags { false }, m_SourceIndex { 0 }, m_MemPolicy { util::MEM_DEFAULT },
+                m_Batch { 1 }, m_BatchLatencyUs { 0 }, m_PipelineActive { false }, m_StagesBound { 0 }, m_StageYieldTime { 0 },
+                m_MaxFloat { 0 }, m_MaxCmplx { 0 }, m_MaxScratch { 0 }, m_Running { false }, m_RunState { 0 },
+                m_RunIterations { 0 }, m_Overruns { 0 }, m_Underruns { 0 }
     {
         m_Name = "THE_CHAIN";
     }
 
     //! Create an instance of a chain.
     //! @param [in] name  The name of the chain. This is for the benefit of the developer.
-    chain(const char *name) : m_Name { name }, m_IsChecked { false }, m_FIdx { 0 }, m_CIdx { 0 }
+    chain(const char *name) : m_Name { name }, m_IsChecked { false }, m_IsBranch { false }, m_Fusion { true }, m_Fused { false },
+                                m_SourceTags { false }, m_SourceIndex { 0 }, m_MemPolicy { util::MEM_DEFAULT },
+                                m_Batch { 1 }, m_BatchLatencyUs { 0 }, m_PipelineActive { false }, m_StagesBound { 0 }, m_StageYieldTime { 0 },
+                                m_MaxFloat { 0 }, m_MaxCmplx { 0 }, m_MaxScratch { 0 }, m_Running { false }, m_RunState { 0 },
+                                m_RunIterations { 0 }, m_Overruns { 0 }, m_Underruns { 0 }
     {
     }
 
+    ~chain()
+    {
+        stop();
+        stopPipeline();
+    }
+
     chain(const chain &) = delete;
     chain& operator=(const chain &) = delete;
 
@@ -117,12 +333,58 @@ public:
     //! \note *block* is no longer valid after calling this method.
     void add(std::unique_ptr<dsp::block<dsp::func_cc>> &&block, const char *name);
 
+    //! Add a branch chain as a tee link. The first link of the branch must take the same type of data
+    //! as the output of the previous link and the last link must be a sink or another tee.
+    //! @param [in] branch  A reference to the branch. It must not have a source.
+    //! @param [in] name    The name of the tee. This is for the benefit of the developer.
+    //! \warning The caller is responsible for making sure the lifetime of the branch is
+    //! maintained while the chain is active. The links of the branch must be added before it's
+    //! added to this chain and *setup()* must not be called for it; the chain does it.
+    void add(chain &branch, const char *name);
+
+    //! Add a branch chain as a tee link. The first link of the branch must take the same type of data
+    //! as the output of the previous link and the last link must be a sink or another tee.
+    //! @param [in] branch  A unique_ptr which contains the branch. It must not have a source.
+    //! @param [in] name    The name of the tee. This is for the benefit of the developer.
+    //! \note *branch* is no longer valid after calling this method. The links of the branch must
+    //! be added before it's added to this chain.
+    void add(std::unique_ptr<chain> &&branch, const char *name);
+
     //! Once all the blocks of a chain have been added, this routine must be called to validate
     //! the links and complete the setup. A failure indicates a problem and it should be fixed
     //! before iteration.
     //! @return **true** if the chain is valid, **false** otherwise.
     bool setup();
 
+    //! Enable or disable the fusion of consecutive element-wise links. It's enabled by default. This
+    //! must be called before *setup()*; for branches, before they are set up by their chain.
+    //! @param [in] enable  **true** to fuse links.
+    void setFusion(const bool enable) { m_Fusion = enable; }
+
+    //! Have each iteration gather several source blocks into one batch before passing it on. This must
+    //! be called before *setup()*. A bidirectional endpoint which is both the source and the sink gets
+    //! the batch back in one call as well.
+    //! @param [in] blocks        The largest number of source blocks in a batch. One turns batching off.
+    //! @param [in] maxLatencyUs  The longest batch in microseconds of source samples, or zero for no cap. A batch
+    //!                           always has at least one block.
+    //! @return **true** if batching is set, **false** if the chain is set up, is a branch or *blocks* is zero.
+    bool setBatch(const uint32_t blocks, const uint32_t maxLatencyUs = 0);
+
+    //! Tag the first sample of each source block with its absolute sample index (*dsp::TAG_SAMPLE_INDEX*)
+    //! and the time it was captured (*dsp::TAG_TIME*), see *dsp::block::getCaptureTime()*. This must be
+    //! called before *setup()*.
+    //! @param [in] enable  **true** to tag the source blocks.
+    void setSourceTags(const bool enable) { m_SourceTags = enable; }
+
+    //! Set how the buffers passed between links, and between pipeline stages, are allocated. For a
+    //! wideband chain they are megabytes in size and benefit from huge pages and from being on the
+    //! NUMA node of the thread iterating the chain. With *util::MEM_NUMA_LOCAL* each pipeline stage
+    //! binds its own buffers and those of its input queue to its node before the stages start; see
+    //! *util::page_alloc* for what's done and how it falls back. Branches use the policy of their
+    //! chain. This must be called before *setup()*.
+    //! @param [in] policy  The allocation policy.
+    void setMemPolicy(const util::mem_policy policy) { m_MemPolicy = policy; }
+
     //! Calling this method will iterate through the chain once. Where this is called and how
     //! often its called is up to the application. For a single threaded app or on a threadless platform,
     //! you would probably call this in a loop and potentially process the results after each call. A multithreaded
@@ -130,8 +392,82 @@ public:
     //! thread via a ring buffer. It really all depends on how much data the chain's source
     //! generates.
     //! \note Always be mindful of overruns in the source and underruns in the sink.
+    //! \warning Do not call this while the pipeline or *run()* is running.
     void iterate();
 
+    //! Iterate the chain on a dedicated thread until *token* is triggered or *stop()* is called. This
+    //! must be called after a successful *setup()* and returns once the thread is up and running.
+    //! @param [in] params  The thread and monitoring parameters. See *run_params*.
+    //! @param [in] token   A stop token; the default token never stops so *stop()* must be used.
+    //! @return **true** if the chain is running, **false** if it isn't set up, is already running, the
+    //!         pipeline is active or one of the requested thread settings could not be applied.
+    //! \note The settings are only supported on Linux; requesting them elsewhere fails.
+    bool run(const run_params &params, const util::stop_token &token = util::stop_token());
+
+    //! Stop a chain started with *run()* and wait for the thread to exit. Calling this when the chain
+    //! isn't running has no effect.
+    //! \warning As with *stopPipeline()*, blocking sources and sinks must be able to return.
+    void stop();
+
+    //! Check if the chain is running, i.e., *run()* succeeded and the loop hasn't stopped yet.
+    bool isRunning() const { return m_Running; }
+
+    //! Get the statistics of the current or last *run()*. This may be called from any thread.
+    //! @param [out] s  The statistics.
+    void getRunStats(run_stats &s) const;
+
+    //! Split the chain into pipeline stages. This must be called after a successful *setup()*
+    //! and before *startPipeline()*. Each stage is a run of consecutive links which will execute
+    //! on its own worker thread.
+    //! @param [in] firstLinks  The index of the first link of each stage except the first stage
+    //!                         which always starts at the source (index 0). The indices must be in
+    //!                         ascending order. An empty vector puts every link in its own stage.
+    //! @param [in] depth       The number of sample blocks which can be queued between two stages.
+    //!                         This must be mod-2.
+    //! @param [in] yieldTime   Time in microseconds a stage yields while waiting on a neighboring stage.
+    //! @return **true** if the stages are valid, **false** otherwise.
+    //! \note A bidirectional endpoint which is both the source and the sink of the chain (e.g., an
+    //! audio endpoint going mic -> speaker) cannot be split across stages since its mode is changed
+    //! on each call.
+    bool setStages(const std::vector<size_t> &firstLinks, const uint32_t depth = 4, const uint32_t yieldTime = 100);
+
+    //! Start the worker threads of each stage. The chain runs on its own until *stopPipeline()*
+    //! is called. The source throttles the chain the same as a loop around *iterate()* would.
+    //! @return **true** if the pipeline started, **false** if the stages were not set or it's already running.
+    bool startPipeline();
+
+    //! Stop the worker threads and wait for them to exit. Blocks which are queued between stages are
+    //! dropped. Calling this when the pipeline isn't running has no effect.
+    //! \warning Sources or sinks which block (e.g., on a *ring_buffer*) must be able to return for the
+    //! stage threads to exit, so stop or abort them first if necessary.
+    void stopPipeline();
+
+    //! Check if the pipeline is running.
+    bool isPipelineActive() const { return m_PipelineActive; }
+
+    //! Get the name of the chain.
+    const char *getName() const { return m_Name; }
+
+    //! Get the profiling results of each link, followed by the links of any branches. This may be
+    //! called from any thread while the chain is running.
+    //! @param [out] s  An empty vector to which the results are written. It is left empty if
+    //!                 neither profiling nor latency tracing is compiled in (see *CHAIN_PROFILING*
+    //!                 and *CHAIN_LATENCY*).
+    void stats(std::vector<link_stats> &s) const;
+
+    //! Get the end-to-end latency of the chain, followed by that of any branches. This may be called
+    //! from any thread while the chain is running.
+    //! @param [out] s  An empty vector to which the results are written. It is left empty if latency
+    //!                 tracing is not compiled in (see *CHAIN_LATENCY*).
+    void latencyStats(std::vector<latency_stats> &s) const;
+
+    //! Clear the profiling results of every link. Only call this while the chain is idle.
+    void resetStats();
+
+    //! Get the number of buffers allocated by the links, including those of any branches, after
+    //! their first call. This should be zero; see the notes above. Only call this while the chain is idle.
+    uint64_t steadyStateAllocs() const;
+
     //! This resets the chain to a cleared state with all allocated objects freed up.
     //! \note You do not have to call this before destruction; this may useful to
     //! an application that needs to rebuild a chain for some reason.
@@ -156,10 +492,26 @@ protected:
         cc = INPUT_CMPLX | OUTPUT_CMPLX
     };
 
+    using link_profiler = util::profiler<PROFILING>;
+    using latency_profiler = util::profiler<LATENCY>;
+
+    // The source stamp carried with each block
+    using latency_mark = latency_profiler::mark_t;
+
+    // What travels with a block besides its samples
+    struct block_meta
+    {
+        block_meta() : stamp { } { }
+
+        latency_mark stamp;
+        dsp::tag_list tags;
+    };
+
     struct link
     {
-        link(const interface i, void *b, const char *n, const dsp::block_type t) :
-            iface { i }, block { b }, name { n }, type { t }, bimode { dsp::BIDIR_NONE }
+        link(const interface i, void *b, const char *n, const dsp::block_type t, const bool ip, chain *br = nullptr) :
+            iface { i }, block { b }, name { n }, type { t }, bimode { dsp::BIDIR_NONE }, inplace { ip }, branch { br },
+            prof { }, lat { }, fusedNs { 0 }, primed { false }, allocs { 0 }, elementwise { false }, fuse { 0 }
         {
             get_sampling_rate = ((t == dsp::TYPE_BIDIR) ||
                                     (t == dsp::TYPE_RESAMPLER) ||
@@ -174,12 +526,88 @@ protected:
         bool  get_sampling_rate;
         const dsp::block_type type;
         dsp::bidir_mode bimode;
+
+        // The block processes in place so it's given the same buffer for input and output.
+        const bool inplace;
+
+        // Only set for tee links
+        chain *branch;
+
+        link_profiler prof;
+        latency_profiler lat;
+
+        // The time spent in the link's span function over the spans of a fused run
+        uint64_t fusedNs;
+
+        // Set after the first call; allocations after that are counted in allocs.
+        bool primed;
+        uint64_t allocs;
+
+        // The block is element-wise; fuse is the number of links from this one to the end of its
+        // run of fusible links or zero if it's not fusible. Runs of two or more are fused.
+        bool elementwise;
+        size_t fuse;
+
+        // Tags a resampler mapped past the end of its output, e.g., while it was filling its first
+        // output sample; they're attached to its next block.
+        dsp::tag_list carry;
+    };
+
+    // Ping-pong buffers used to pass blocks from one link to the next; there is one set per thread
+    // which iterates over the links.
+    struct link_buffers
+    {
+        link_buffers() : fIdx { 0 }, cIdx { 0 } { }
+
+        util::aligned_ptr<float>                fBuff[2];
+        util::aligned_ptr<rm_math::complex_f>   cBuff[2];
+        uint8_t fIdx;
+        uint8_t cIdx;
+
+        // The source stamp and tags of the current block
+        block_meta meta;
+
+        // The spans passed between fused links
+        util::aligned_ptr<float>                fSpan;
+        util::aligned_ptr<rm_math::complex_f>   cSpan;
+
+        // The scratch memory of the links, shared by all of them since only one runs at a time
+        util::aligned_ptr<uint8_t> scratchMem;
+        util::workspace scratch;
+    };
+
+    // A queue slot used to hand a block from one pipeline stage to the next.
+    struct stage_block
+    {
+        stage_block() : rate { 0 } { }
+
+        util::aligned_ptr<float>                fBuff;
+        util::aligned_ptr<rm_math::complex_f>   cBuff;
+        dsp::rate_t rate;
+        block_meta meta;
+    };
+
+    using stage_queue = util::spsc_queue<stage_block>;
+
+    // A run of links [first, last) which executes on a worker thread when pipelined.
+    struct stage
+    {
+        stage(const size_t f, const size_t l) : first { f }, last { l }, in { nullptr }, out { nullptr } { }
+
+        size_t first;
+        size_t last;
+        link_buffers bufs;
+        stage_queue *in;
+        stage_queue *out;
+        std::unique_ptr<std::thread> th;
     };
 
     std::vector<link> m_Chain;
 
-    util::aligned_ptr<float>                m_fBuff[2];
-    util::aligned_ptr<rm_math::complex_f>   m_cBuff[2];
+    link_buffers m_Buffs;
+
+    std::vector<stage> m_Stages;
+    std::vector<std::unique_ptr<stage_queue>> m_StageQueues;
 
     // Holders for owned pointers to block instances - they get released by the clear() method or
     // by instance destruction.
@@ -187,6 +615,7 @@ protected:
     std::vector<std::unique_ptr<dsp::block<dsp::func_fc>>> m_FloatCmplxBlocks;
     std::vector<std::unique_ptr<dsp::block<dsp::func_cf>>> m_CmplxFloatBlocks;
     std::vector<std::unique_ptr<dsp::block<dsp::func_cc>>> m_CmplxBlocks;
+    std::vector<std::unique_ptr<chain>> m_Branches;
 
     static constexpr uint8_t IN_MASK        = 1;
     static constexpr uint8_t OUT_MASK       = 2;
@@ -199,12 +628,249 @@ protected:
         return (((link1 & OUT_MASK) >> 1) == (link2 & IN_MASK));
     }
 
-    // Handles the processing of each link during an iteration.
+    // Runs the links [first, last) once using the given set of buffers. If given, *fIn* or *cIn* is
+    // the input of the first link instead of the current buffer (used by branches).
+    void iterateLinks(const size_t first, const size_t last, dsp::rate_t &rate, link_buffers &bufs,
+                        const util::aligned_ptr<float> *fIn = nullptr,
+                        const util::aligned_ptr<rm_math::complex_f> *cIn = nullptr);
+
+    // Validate the links of the chain; shared by *setup()* and branch setup.
+    bool checkLinks();
+
+    // Find the runs of element-wise links which are fused.
+    void fuseLinks();
+
+    // Runs the *n* fused links starting at *first* in one pass. The buffers and external inputs
+    // are the same as iterateLinks().
+    void iterateFused(const size_t first, const size_t n, dsp::rate_t &rate, link_buffers &bufs,
+                        const util::aligned_ptr<float> *fIn, const util::aligned_ptr<rm_math::complex_f> *cIn);
+
+    // Runs the source of the chain until a batch is gathered. See setBatch().
+    void iterateBatch(dsp::rate_t &rate, link_buffers &bufs);
+
+    // Call the source *m_Batch* times, or until the latency cap, and append each block from *part* to *batch*.
+    // The batch keeps the stamp of its first block and the tags of every block.
     template<typename T, typename U, typename V>
-    void handleLink(const link &lnk, dsp::rate_t &rate, util::aligned_ptr<U> &in, util::aligned_ptr<V> &out)
+    void gatherSource(link &lnk, dsp::rate_t &rate, const util::aligned_ptr<U> &in, util::aligned_ptr<V> &part,
+                        util::aligned_ptr<V> &batch, link_buffers &bufs)
+    {
+        block_meta &meta = bufs.meta;
+        latency_mark first { };
+
+        // Like a link, the first batch may size the buffer.
+        const bool primed = lnk.primed;
+
+        util::init_aligned_ptr_on_resize<V>(batch, 0);
+
+        for (uint32_t i=0;i < m_Batch;i++)
+        {
+            size_t tagged = meta.tags.size();
+
+            handleLink<T, U, V>(lnk, rate, in, part, bufs);
+
+            if (!i)
+                first = meta.stamp;
+
+            if (!part.size())
+                break;
+
+            // The batch buffers are planned for the whole batch so this shouldn't allocate unless
+            // the source didn't declare its block size or went past it.
+            auto allocs = util::aligned_ptr_allocs();
+            size_t used = batch.size();
+
+            // The tags of this block move along with it.
+            for (size_t j=tagged;j < meta.tags.size();j++)
+                meta.tags[j].offset += used;
+
+            growBuffer<V>(batch, used + part.size());
+            std::memcpy(&batch[used], part.data(), part.size() * sizeof(V));
+
+            allocs = util::aligned_ptr_allocs() - allocs;
+
+            if (primed && allocs)
+            {
+                m_Trace.print(ID, "Batch of %s allocated %u buffer(s)\n", lnk.name, static_cast<uint32_t>(allocs));
+                lnk.allocs += allocs;
+                assert(!ALLOC_CHECK);
+            }
+
+            // Stop if another block of the same size would go past the cap.
+            if (m_BatchLatencyUs && rate &&
+                (((batch.size() + part.size()) * 1000000ULL) / rate > m_BatchLatencyUs))
+                break;
+        }
+
+        meta.stamp = first;
+    }
+
+    // Attach a tag to the current block unless it's full.
+    static void addTag(block_meta &meta, const dsp::stream_tag &tag)
+    {
+        if (meta.tags.size() < meta.tags.capacity())
+            meta.tags.push_back(tag);
+    }
+
+    // Move the tags of a block which went through a resampler to the matching output samples. The
+    // tags carried over from earlier blocks come first; those which land past the end of the output
+    // are carried over to the next block. Neither list grows past MAX_TAGS so this doesn't allocate.
+    template<typename T>
+    static void moveTags(const dsp::block<T> *blk, dsp::tag_list &tags, dsp::tag_list &carry, const size_t outSize)
+    {
+        for (auto &tag : tags)
+        {
+            tag.offset = blk->getOutputOffset(tag.offset);
+
+            if (tag.key == dsp::TAG_SAMPLE_INDEX)
+                tag.index = blk->getOutputIndex(tag.index);
+        }
+
+        const size_t carried = std::min(carry.size(), tags.capacity() - tags.size());
+
+        tags.insert(tags.begin(), carry.begin(), carry.begin() + carried);
+        carry.clear();
+
+        size_t kept = 0;
+
+        for (size_t i=0;i < tags.size();i++)
+        {
+            if (tags[i].offset < outSize)
+                tags[kept++] = tags[i];
+            else
+            {
+                carry.push_back(tags[i]);
+                carry.back().offset -= outSize;
+            }
+        }
+
+        tags.resize(kept);
+    }
+
+    // Give a fused link what handleLink() would have.
+    template<typename T>
+    static void prepareFused(const link &lnk, const dsp::rate_t rate, link_buffers &bufs)
     {
         auto blk = static_cast<dsp::block<T> *>(lnk.block);
 
+        blk->setSamplingRate(rate);
+        blk->setTags(&bufs.meta.tags);
+        blk->setWorkspace(&bufs.scratch);
+    }
+
+    // Call the span function of an element-wise link.
+    template<typename T>
+    static void callKernel(const link &lnk, const void *in, void *out, const size_t n)
+    {
+        using in_t = typename dsp::block_io<T>::in_type;
+        using out_t = typename dsp::block_io<T>::out_type;
+
+        static_cast<dsp::block<T> *>(lnk.block)->getKernel()(static_cast<const in_t *>(in), static_cast<out_t *>(out), n);
+    }
+
+    // Validate and set up a chain which was added as a branch.
+    bool setupBranch();
+
+    // Size the buffers of the chain, and any branches, for an input of up to *maxIn* samples.
+    void planBuffers(size_t maxIn);
+
+    // Size a set of buffers from the plan.
+    void reserveBuffers(link_buffers &bufs);
+
+    // Make sure a buffer can hold *size* samples and is allocated by the memory policy. The buffer is
+    // left empty.
+    template<typename T>
+    void reserveBuffer(util::aligned_ptr<T> &buff, const size_t size)
+    {
+        util::set_aligned_ptr_policy<T>(buff, m_MemPolicy);
+
+        if (buff.capacity() < size)
+        {
+            util::init_aligned_ptr<T>(buff, size);
+            util::init_aligned_ptr_on_resize<T>(buff, 0);
+        }
+    }
+
+    // Prefer the NUMA node of the calling thread for a buffer allocated with MEM_NUMA_LOCAL.
+    template<typename T>
+    static void bindBuffer(util::aligned_ptr<T> &buff)
+    {
+        if (buff.capacity())
+            util::page_alloc::bindToCurrentNode(buff.data(), buff.capacity() * sizeof(T), buff.policy());
+    }
+
+    // Resize a buffer to *size* samples keeping the ones it holds, unlike init_aligned_ptr_on_resize()
+    // which drops them when it has to re-allocate. It at least doubles so a growing batch settles.
+    template<typename T>
+    static void growBuffer(util::aligned_ptr<T> &buff, const size_t size)
+    {
+        if (size > buff.capacity())
+        {
+            util::aligned_ptr<T> grown;
+
+            util::set_aligned_ptr_policy<T>(grown, buff.policy());
+            util::init_aligned_ptr<T>(grown, std::max(size, 2 * buff.capacity()));
+
+            if (buff.size())
+                std::memcpy(&grown[0], buff.data(), buff.size() * sizeof(T));
+
+            util::init_aligned_ptr_on_resize<T>(grown, buff.size());
+            buff = std::move(grown);
+        }
+
+        util::init_aligned_ptr_on_resize<T>(buff, size);
+    }
+
+    // Give a link the largest input it will see and get the largest output it will produce.
+    template<typename T>
+    size_t sizeLink(const link &lnk, const size_t maxIn)
+    {
+        auto blk = static_cast<dsp::block<T> *>(lnk.block);
+
+        blk->setMaxInputSize(maxIn);
+        m_MaxScratch = std::max(m_MaxScratch, blk->getScratchSize(maxIn));
+
+        if ((lnk.type == dsp::TYPE_SOURCE) || (lnk.bimode == dsp::BIDIR_SOURCE))
+            return blk->getMaxSourceSize();
+
+        if ((lnk.type == dsp::TYPE_SINK) || (lnk.bimode == dsp::BIDIR_SINK))
+            return 0;
+
+        return blk->getMaxOutputSize(maxIn);
+    }
+
+    // Check if a link may terminate a chain.
+    bool isSinkLink(const link &lnk) const
+    {
+        return (lnk.branch || (lnk.type == dsp::TYPE_SINK) || (lnk.type == dsp::TYPE_BIDIR));
+    }
+
+    // The worker thread of a pipeline stage.
+    void stageThread(stage &stg);
+
+    // Bind the buffers a stage starts with and those of its input queue to the stage's node.
+    void bindStage(stage &stg);
+
+    // The thread started by run() and its helpers
+    void runThread();
+    bool applyRunParams();
+    static bool lockMemory();
+    static void unlockMemory();
+    void checkRingBuffers(util::ring_buffer_diag &source, util::ring_buffer_diag &sink);
+
+    // Handles the processing of each link during an iteration. Sources set the stamp of the block's
+    // meta; every link measures its latency from it. Sources add tags to the meta, and every link can
+    // read them. The link takes its temporaries from the scratch of *bufs*.
+    template<typename T, typename U, typename V>
+    void handleLink(link &lnk, dsp::rate_t &rate, const util::aligned_ptr<U> &in, util::aligned_ptr<V> &out,
+                        link_buffers &bufs)
+    {
+        auto blk = static_cast<dsp::block<T> *>(lnk.block);
+        const bool source = ((lnk.type == dsp::TYPE_SOURCE) || (lnk.bimode == dsp::BIDIR_SOURCE));
+        block_meta &meta = bufs.meta;
+
+        blk->setTags(&meta.tags);
+        blk->setWorkspace(&bufs.scratch);
+
         // Set the sampling rate of the current link to what was set by a previous link.
         blk->setSamplingRate(rate);
 
@@ -214,7 +880,49 @@ protected:
         m_LinkTrace.print(ID, "Process link %s: wr sr %u\n", lnk.name, rate);
 
         // Call the processor.
+        auto allocs = util::aligned_ptr_allocs();
+        auto mark = lnk.prof.start();
+        util::timer::timer_t captured;
+
+        if (LATENCY && source)
+            meta.stamp = lnk.lat.start();
+
+        if (m_SourceTags && source)
+            captured = util::timer::StartTimer();
+
         blk->getProcesser()(in, out);
+        lnk.prof.stop(mark,
+                        source ? 0 : in.size(),
+                        ((lnk.type == dsp::TYPE_SINK) || (lnk.bimode == dsp::BIDIR_SINK)) ? 0 : out.size());
+
+        // A source which knows when the block was captured dates it back to then. Reading the
+        // time clears it, so it's always taken to keep it from going stale.
+        if (source && blk->getCaptureTime(captured) && (LATENCY || m_SourceTags))
+            meta.stamp = latency_profiler::at(captured);
+
+        lnk.lat.stop(meta.stamp, 0, 0);
+
+        if (m_SourceTags && source)
+        {
+            addTag(meta, dsp::stream_tag::sampleIndex(0, m_SourceIndex));
+            addTag(meta, dsp::stream_tag::time(0, util::timer::Ns(captured)));
+            m_SourceIndex += out.size();
+        }
+
+        if ((lnk.type == dsp::TYPE_RESAMPLER) && !(meta.tags.empty() && lnk.carry.empty()))
+            moveTags(blk, meta.tags, lnk.carry, out.size());
+
+        // Anything allocated after the first call (which may size the buffers) is a problem.
+        allocs = util::aligned_ptr_allocs() - allocs;
+
+        if (lnk.primed && allocs)
+        {
+            m_Trace.print(ID, "Link %s allocated %u buffer(s) in steady state\n", lnk.name, static_cast<uint32_t>(allocs));
+            lnk.allocs += allocs;
+            assert(!ALLOC_CHECK);
+        }
+
+        lnk.primed = true;
 
         // If the current link is a source or resampler, then
         // copy the sampling rate from the current link for the next links.
@@ -229,8 +937,43 @@ protected:
 
     const char *m_Name;
     bool m_IsChecked;
-    uint8_t m_FIdx;
-    uint8_t m_CIdx;
+    bool m_IsBranch;
+    bool m_Fusion;
+    bool m_Fused;
+
+    // See setSourceTags(); the index of the next source sample
+    bool m_SourceTags;
+    uint64_t m_SourceIndex;
+    util::mem_policy m_MemPolicy;
+
+    // Source blocks per batch and the latency cap, see setBatch()
+    uint32_t m_Batch;
+    uint32_t m_BatchLatencyUs;
+
+    std::atomic<bool> m_PipelineActive;
+    std::atomic<uint32_t> m_StagesBound;
+    uint32_t m_StageYieldTime;
+
+    // End-to-end latency, measured after the last link
+    latency_profiler m_Latency;
+
+    // The largest float and complex blocks passed between links, from planBuffers()
+    size_t m_MaxFloat;
+    size_t m_MaxCmplx;
+
+    // The most scratch any link needs, from planBuffers()
+    size_t m_MaxScratch;
+
+    // run() state; m_RunState is set by the thread: 1 = running, -1 = the parameters failed
+    std::unique_ptr<std::thread> m_RunTh;
+    run_params m_RunParams;
+    util::stop_token m_RunToken;
+    util::stop_source m_RunStop;
+    std::atomic<bool> m_Running;
+    std::atomic<int> m_RunState;
+    std::atomic<uint64_t> m_RunIterations;
+    std::atomic<uint32_t> m_Overruns;
+    std::atomic<uint32_t> m_Underruns;
 
     static constexpr char const *ID = "CHAIN";
 
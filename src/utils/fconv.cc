@@ -5,6 +5,7 @@
 //! \file fconv.cc
 
 #include <cstring>
+#include <cassert>
 #include <fconv.h>
 
 using namespace util;
@@ -76,8 +77,24 @@ void fconv::setupTaps()
 
 std::vector<float> fconv::convolve(const float *b, bool stripEdges)
 {
-    std::vector<float> res;
+    std::vector<float> res(size(stripEdges));
 
+    convolve(b, aligned_span<float> { res }, stripEdges);
+
+    return res;
+}
+
+std::vector<rm_math::complex_f> fconv::convolve(const rm_math::complex_f *b, bool stripEdges)
+{
+    std::vector<rm_math::complex_f> res(size(stripEdges));
+
+    convolve(b, aligned_span<rm_math::complex_f> { res }, stripEdges);
+
+    return res;
+}
+
+size_t fconv::convolve(const float *b, aligned_span<float> out, bool stripEdges)
+{
     std::memset(m_Buff, 0, m_DftSize * sizeof(fftwf_complex));
 
     for (size_t i=0;i < m_M;i++)
@@ -89,21 +106,18 @@ std::vector<float> fconv::convolve(const float *b, bool stripEdges)
     execute();
 
     size_t start = (stripEdges) ? m_N : 0;
-    size_t end = (stripEdges) ? m_DftSize - m_N + 1: m_DftSize - 1;
+    size_t count = size(stripEdges);
 
-    for (size_t i=start;i <= end;i++)
-    {
-        float val = m_Buff[i][0] * m_A;
-        res.push_back(val);
-    }
+    assert(out.size() >= count);
 
-    return res;
+    for (size_t i=0;i < count;i++)
+        out[i] = m_Buff[start + i][0] * m_A;
+
+    return count;
 }
 
-std::vector<rm_math::complex_f> fconv::convolve(const rm_math::complex_f *b, bool stripEdges)
+size_t fconv::convolve(const rm_math::complex_f *b, aligned_span<rm_math::complex_f> out, bool stripEdges)
 {
-    std::vector<rm_math::complex_f> res;
-
     std::memset(m_Buff, 0, m_DftSize * sizeof(fftwf_complex));
 
     for (size_t i=0;i < m_M;i++)
@@ -113,17 +127,16 @@ std::vector<rm_math::complex_f> fconv::convolve(const rm_math::complex_f *b, boo
     }
 
     execute();
-    
+
     size_t start = (stripEdges) ? m_N : 0;
-    size_t end = (stripEdges) ? m_DftSize - m_N + 1: m_DftSize - 1;
+    size_t count = size(stripEdges);
 
-    for (size_t i=start;i <= end;i++)
-    {
-        rm_math::complex_f val(m_Buff[i][0] * m_A, m_Buff[i][1] * m_A);
-        res.push_back(val);
-    }
+    assert(out.size() >= count);
 
-    return res;
+    for (size_t i=0;i < count;i++)
+        out[i] = rm_math::complex_f(m_Buff[start + i][0] * m_A, m_Buff[start + i][1] * m_A);
+
+    return count;
 }
 
 void fconv::execute()
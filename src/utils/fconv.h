@@ -52,6 +52,27 @@ public:
     //!             type *complex*. Otherwise, returns m + n - 1 results.
     std::vector<rm_math::complex_f> convolve(const rm_math::complex_f *b, bool stripEdges = false);
 
+    //! Same as above but the results go into *out*, e.g., part of a block, instead of a new vector.
+    //! @param [in]  b          The samples to convolve with the taps of this instance.
+    //! @param [out] out        Where the results go; it must hold at least *size(stripEdges)* results.
+    //! @param [in]  stripEdges If true, strip the overlapping edges, otherwise return the full convolution.
+    //! @return     The number of results written.
+    size_t convolve(const float *b, aligned_span<float> out, bool stripEdges = false);
+
+    //! Same as above but the results go into *out*, e.g., part of a block, instead of a new vector.
+    //! @param [in]  b          The samples to convolve with the taps of this instance.
+    //! @param [out] out        Where the results go; it must hold at least *size(stripEdges)* results.
+    //! @param [in]  stripEdges If true, strip the overlapping edges, otherwise return the full convolution.
+    //! @return     The number of results written.
+    size_t convolve(const rm_math::complex_f *b, aligned_span<rm_math::complex_f> out, bool stripEdges = false);
+
+    //! Get the number of results of a call to *convolve()*.
+    //! @param [in] stripEdges  If the overlapping edges are stripped.
+    size_t size(bool stripEdges = false) const
+    {
+        return stripEdges ? m_DftSize - 2 * m_N + 2 : m_DftSize;
+    }
+
 private:
     fftwf_plan m_FwdPlan;
     fftwf_plan m_RevPlan;
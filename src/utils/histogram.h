@@ -0,0 +1,144 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace util {
+
+/*! \brief Lock-free Log-linear Histogram
+ *
+ * Counts unsigned integer values (e.g., durations in nanoseconds or buffer fill levels) into
+ * bins which double in width every four bins, so each bin spans at most 25% of its lower bound
+ * and any value up to 2^64 - 1 fits in a small, fixed amount of memory. Values below four are
+ * counted exactly.
+ *
+ * Adding a value is a single relaxed atomic increment so one thread can record while other
+ * threads read the results without locking. Results read while values are being added are a
+ * snapshot and may be off by the values in flight.
+ */
+
+class histogram
+{
+public:
+
+    //! The number of bins.
+    static constexpr size_t BINS = 252;
+
+    histogram()
+    {
+        reset();
+    }
+
+    histogram(const histogram &) = delete;
+    histogram& operator=(const histogram &) = delete;
+
+    //! Count a value.
+    //! @param [in] value  The value to count.
+    void add(const uint64_t value)
+    {
+        m_Bins[index(value)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    //! Get the total number of values counted.
+    uint64_t count() const
+    {
+        uint64_t total = 0;
+
+        for (size_t i=0;i < BINS;i++)
+            total += m_Bins[i].load(std::memory_order_relaxed);
+
+        return total;
+    }
+
+    //! Get the value at a percentile.
+    //! @param [in] p  The percentile as a fraction, e.g., 0.99 for the 99th percentile.
+    //! @return The upper bound of the bin which contains the percentile or zero if nothing was counted.
+    uint64_t percentile(const double p) const
+    {
+        uint64_t total = count();
+
+        if (!total)
+            return 0;
+
+        uint64_t target = static_cast<uint64_t>(p * total + 0.5);
+        uint64_t sum = 0;
+
+        if (!target)
+            target = 1;
+
+        for (size_t i=0;i < BINS;i++)
+        {
+            sum += m_Bins[i].load(std::memory_order_relaxed);
+
+            if (sum >= target)
+                return upperBound(i);
+        }
+
+        return upperBound(BINS - 1);
+    }
+
+    //! Get the number of values counted in a bin.
+    //! @param [in] bin  The bin index (0 .. BINS - 1).
+    uint64_t bin(const size_t bin) const
+    {
+        return (bin < BINS) ? m_Bins[bin].load(std::memory_order_relaxed) : 0;
+    }
+
+    //! Get the smallest value counted in a bin.
+    //! @param [in] bin  The bin index (0 .. BINS - 1).
+    static uint64_t lowerBound(const size_t bin)
+    {
+        if (bin < SUB_BINS)
+            return bin;
+
+        return static_cast<uint64_t>(SUB_BINS + (bin & SUB_MASK)) << ((bin >> SUB_BITS) - 1);
+    }
+
+    //! Get the largest value counted in a bin.
+    //! @param [in] bin  The bin index (0 .. BINS - 1).
+    static uint64_t upperBound(const size_t bin)
+    {
+        return (bin < (BINS - 1)) ? (lowerBound(bin + 1) - 1) : UINT64_MAX;
+    }
+
+    //! Get the bin index for a value.
+    static size_t index(const uint64_t value)
+    {
+        if (value < SUB_BINS)
+            return static_cast<size_t>(value);
+
+        const unsigned msb = 63 - __builtin_clzll(value);
+
+        return ((msb - SUB_BITS + 1) << SUB_BITS) + ((value >> (msb - SUB_BITS)) & SUB_MASK);
+    }
+
+    //! Copy the counts of another histogram. Neither may be added to meanwhile.
+    //! @param [in] other  The histogram to copy.
+    void assign(const histogram &other)
+    {
+        for (size_t i=0;i < BINS;i++)
+            m_Bins[i].store(other.m_Bins[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+    }
+
+    //! Clear all bins.
+    void reset()
+    {
+        for (size_t i=0;i < BINS;i++)
+            m_Bins[i].store(0, std::memory_order_relaxed);
+    }
+
+private:
+
+    static constexpr unsigned SUB_BITS = 2;
+    static constexpr unsigned SUB_BINS = 1 << SUB_BITS;
+    static constexpr unsigned SUB_MASK = SUB_BINS - 1;
+
+    std::atomic<uint64_t> m_Bins[BINS];
+};
+
+}
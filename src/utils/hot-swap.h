@@ -0,0 +1,107 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace util {
+
+/*! \brief Lock-free Hand-off of Replacement State to a Processing Thread
+ *
+ * This is a minimal read-copy-update (RCU) scheme between one *publisher* thread (e.g., a UI or control
+ * thread) and one *reader* (the thread processing a block). The publisher builds the replacement,
+ * e.g., a new set of filter taps, and hands it over with *publish()*. The reader calls *apply()* at a
+ * convenient point, e.g., the start of a block, which swaps the replacement in if there is one. Neither
+ * side locks and the reader never allocates or frees anything.
+ *
+ * The reader swaps its current state into the replacement object, which is then *retired* and freed
+ * by the publisher on its next *publish()* (or *reclaim()*). That is the grace period: an object is
+ * only retired once the reader is done with it, so the publisher never frees anything the reader may
+ * still use. If the publisher publishes again before the reader applied the previous replacement, the
+ * previous one is freed without ever being used.
+ *
+ * \note Only one thread at a time may publish; only one thread at a time may apply.
+ */
+
+template<typename T>
+class hot_swap
+{
+public:
+
+    hot_swap() : m_Pending { nullptr }, m_Retired { nullptr } { }
+
+    ~hot_swap()
+    {
+        delete m_Pending.load();
+        reclaim();
+    }
+
+    hot_swap(const hot_swap &) = delete;
+    hot_swap& operator=(const hot_swap &) = delete;
+
+    hot_swap(hot_swap &&) = delete;
+    hot_swap& operator=(hot_swap &&) = delete;
+
+    //! Publisher side. Hand a replacement over to the reader and free anything retired since the last call.
+    //! @param [in] next  The replacement.
+    void publish(std::unique_ptr<T> &&next)
+    {
+        reclaim();
+        delete m_Pending.exchange(new node { std::move(next), nullptr }, std::memory_order_acq_rel);
+    }
+
+    //! Publisher side. Free anything retired by the reader.
+    void reclaim()
+    {
+        node *n = m_Retired.exchange(nullptr, std::memory_order_acquire);
+
+        while(n)
+        {
+            node *next = n->next;
+            delete n;
+            n = next;
+        }
+    }
+
+    //! Reader side. Swap in the replacement, if one was published.
+    //! @param [in] swapIn  Called with the replacement. It must swap the reader's state with the
+    //!                     contents of the replacement so the old state is what gets retired.
+    //! @return **true** if a replacement was swapped in.
+    template<typename F>
+    bool apply(F &&swapIn)
+    {
+        if (!m_Pending.load(std::memory_order_relaxed))
+            return false;
+
+        node *n = m_Pending.exchange(nullptr, std::memory_order_acq_rel);
+
+        if (!n)
+            return false;
+
+        swapIn(*n->value);
+
+        // Push it on the retired list; the publisher only ever takes the whole list.
+        n->next = m_Retired.load(std::memory_order_relaxed);
+
+        while(!m_Retired.compare_exchange_weak(n->next, n, std::memory_order_release, std::memory_order_relaxed))
+            ;
+
+        return true;
+    }
+
+private:
+
+    struct node
+    {
+        std::unique_ptr<T> value;
+        node *next;
+    };
+
+    std::atomic<node*> m_Pending;
+    std::atomic<node*> m_Retired;
+};
+
+}
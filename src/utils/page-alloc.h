@@ -0,0 +1,424 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "rm-math.h"
+
+namespace util {
+
+//! How the memory of a large buffer is allocated. The flags can be combined.
+enum mem_policy : uint8_t
+{
+    MEM_DEFAULT         = 0,        // The math library allocator (see *rm_math::rm_malloc()*).
+    MEM_HUGE_PAGES      = 1 << 0,   // Back the buffer with 2 MiB pages to cut TLB misses, if it's big enough.
+    MEM_NUMA_LOCAL      = 1 << 1,   // Place each page on the NUMA node of the thread which first writes it,
+                                    // or of its consumer, see *page_alloc::bindToCurrentNode()*.
+    MEM_MIRRORED        = 1 << 2    // Map the buffer twice back to back; only *ring_buffer* uses it,
+                                    // see *page_alloc::allocMirrored()*.
+};
+
+//! Combine two policies.
+inline constexpr mem_policy operator|(const mem_policy a, const mem_policy b)
+{
+    return static_cast<mem_policy>(static_cast<uint8_t>(a) | static_cast<uint8_t>(b));
+}
+
+//! What *page_alloc* managed to do, summed over all threads, see *page_alloc::getStats()*.
+struct page_alloc_stats
+{
+    uint32_t hugeTlb;       // Buffers backed by reserved huge pages (MAP_HUGETLB)
+    uint32_t transparent;   // Buffers given transparent huge pages instead (MADV_HUGEPAGE)
+    uint32_t smallPages;    // Huge page buffers which got neither and use regular pages
+    uint32_t belowMin;      // Huge page buffers under *page_alloc::HUGE_PAGE_MIN* given regular pages
+    uint32_t numaLocal;     // Buffers bound to the local node
+    uint32_t numaFailed;    // Buffers which could not be bound, e.g., no NUMA support
+    uint32_t numaConsumer;  // Buffers moved to the node of their consumer, see *page_alloc::bindToCurrentNode()*
+    uint32_t mirrored;      // Buffers mapped twice back to back, see *page_alloc::allocMirrored()*
+    uint32_t unmapped;      // Buffers no pages could be mapped for, taken from the math library allocator
+};
+
+/*! \brief Allocation of Large Buffers by Policy
+ *
+ * The chain's ping-pong buffers and *ring_buffer* storage of a wideband capture are megabytes in size.
+ * With *MEM_HUGE_PAGES* they're mapped in 2 MiB pages, first from the reserved huge page pool
+ * (MAP_HUGETLB) and, when that's empty or not configured, as transparent huge pages (MADV_HUGEPAGE).
+ * A buffer smaller than *HUGE_PAGE_MIN* would mostly be padding, so it gets regular pages instead.
+ *
+ * With *MEM_NUMA_LOCAL* the pages are bound with MPOL_LOCAL so each lands on the NUMA node of the
+ * thread that first writes it. The mapping isn't touched here, so that's the thread which fills the
+ * buffer rather than the one setting it up: the producer of a ring buffer or of a chain's stage
+ * queue. Their consumers call *bindToCurrentNode()* before they start reading, which prefers their
+ * own node for the buffer, moves any pages already placed and faults in the rest there.
+ *
+ * Every step falls back quietly; the buffer is regular anonymous memory if it can't have huge pages,
+ * and comes from the math library allocator if no pages can be mapped at all. *release()* remembers
+ * which, so it's freed the right way. *MEM_DEFAULT*, or a platform other than Linux, uses the math
+ * library allocator. Mapped buffers are page aligned, which satisfies the math library alignment.
+ * Check *getStats()* to see what was granted.
+ *
+ * *allocMirrored()* maps the same memory twice, one copy right after the other, for ring buffers
+ * which hand out contiguous regions that run past the end of their storage.
+ */
+
+class page_alloc
+{
+public:
+
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    //! The smallest buffer *MEM_HUGE_PAGES* is applied to; rounding a smaller one up to a huge page
+    //! would waste more than half of it.
+    static constexpr size_t HUGE_PAGE_MIN = HUGE_PAGE_SIZE / 2;
+
+    //! Allocate a buffer.
+    //! @param [in] bytes   The size of the buffer in bytes.
+    //! @param [in] policy  How to allocate it.
+    //! @return The buffer, or **nullptr** if there's no memory. Release it with *release()* and the
+    //!         same *bytes* and *policy*.
+    static void* alloc(const size_t bytes, const mem_policy policy)
+    {
+#ifdef __linux__
+        if (policy == MEM_DEFAULT)
+            return rm_math::rm_malloc<uint8_t>(bytes);
+
+        const size_t len = mappedBytes(bytes, policy);
+        const bool huge = hugePages(bytes, policy);
+        void *ptr = MAP_FAILED;
+
+        if ((policy & MEM_HUGE_PAGES) && !huge)
+            ++counters().belowMin;
+
+#ifdef MAP_HUGETLB
+        if (huge)
+        {
+            ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+            if (ptr != MAP_FAILED)
+                ++counters().hugeTlb;
+        }
+#endif
+
+        if (ptr == MAP_FAILED)
+        {
+            ptr = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (ptr == MAP_FAILED)
+                return allocUnmapped(bytes);
+
+            if (huge)
+            {
+#ifdef MADV_HUGEPAGE
+                if (!madvise(ptr, len, MADV_HUGEPAGE))
+                    ++counters().transparent;
+                else
+#endif
+                    ++counters().smallPages;
+            }
+        }
+
+        if (policy & MEM_NUMA_LOCAL)
+        {
+            if (!syscall(SYS_mbind, ptr, len, MPOL_LOCAL, nullptr, 0, 0))
+                ++counters().numaLocal;
+            else
+                ++counters().numaFailed;
+        }
+
+        return ptr;
+#else
+        return rm_math::rm_malloc<uint8_t>(bytes);
+#endif
+    }
+
+    //! Release a buffer from *alloc()*.
+    //! @param [in] ptr     The buffer.
+    //! @param [in] bytes   The size passed to *alloc()*.
+    //! @param [in] policy  The policy passed to *alloc()*.
+    static void release(void *ptr, const size_t bytes, const mem_policy policy)
+    {
+#ifdef __linux__
+        if ((policy != MEM_DEFAULT) && !isUnmapped(ptr, true))
+        {
+            munmap(ptr, mappedBytes(bytes, policy));
+            return;
+        }
+#endif
+        rm_math::rm_free(ptr);
+    }
+
+    //! Allocate a buffer whose memory is mapped twice, back to back, so the *bytes* following it
+    //! are the buffer again: writing *ptr[bytes + i]* writes *ptr[i]*. The memory is a memfd mapped
+    //! into a reserved range of twice the size. Huge pages aren't used for it.
+    //! @param [in] bytes   The size of the buffer in bytes. It must be a multiple of *pageSize()*.
+    //! @param [in] policy  How to allocate it; only *MEM_NUMA_LOCAL* applies.
+    //! @return The buffer, or **nullptr** if the size isn't a multiple of the page size or the
+    //!         platform can't do it. Release it with *releaseMirrored()*.
+    static void* allocMirrored(const size_t bytes, const mem_policy policy)
+    {
+#if defined(__linux__) && defined(SYS_memfd_create)
+        if (!bytes || (bytes % pageSize()))
+            return nullptr;
+
+        const int fd = static_cast<int>(syscall(SYS_memfd_create, "radiomon-mirror", MEMFD_CLOEXEC));
+
+        if (fd < 0)
+            return nullptr;
+
+        uint8_t *base = nullptr;
+
+        if (!ftruncate(fd, static_cast<off_t>(bytes)))
+        {
+            // Reserve the whole range so nothing else can be mapped between the two copies.
+            void *range = mmap(nullptr, 2 * bytes, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+            if (range != MAP_FAILED)
+            {
+                base = static_cast<uint8_t*>(range);
+
+                if ((mmap(base, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != base) ||
+                    (mmap(base + bytes, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) != base + bytes))
+                {
+                    munmap(base, 2 * bytes);
+                    base = nullptr;
+                }
+            }
+        }
+
+        // The mappings keep the memory alive.
+        close(fd);
+
+        if (!base)
+            return nullptr;
+
+        ++counters().mirrored;
+
+        if (policy & MEM_NUMA_LOCAL)
+        {
+            if (!syscall(SYS_mbind, base, bytes, MPOL_LOCAL, nullptr, 0, 0))
+                ++counters().numaLocal;
+            else
+                ++counters().numaFailed;
+        }
+
+        return base;
+#else
+        return nullptr;
+#endif
+    }
+
+    //! Release a buffer from *allocMirrored()*.
+    //! @param [in] ptr     The buffer.
+    //! @param [in] bytes   The size passed to *allocMirrored()*.
+    static void releaseMirrored(void *ptr, const size_t bytes)
+    {
+#ifdef __linux__
+        munmap(ptr, 2 * bytes);
+#endif
+    }
+
+    //! Prefer the NUMA node of the calling thread for a buffer from *alloc()* or *allocMirrored()*.
+    //! Pages already placed elsewhere are moved where the kernel can and the rest are faulted in
+    //! now, without changing the contents, so another thread may be writing the buffer meanwhile.
+    //! It's meant for the consumer of a buffer, once before it starts reading.
+    //! @param [in] ptr     The buffer.
+    //! @param [in] bytes   The size passed to *alloc()*.
+    //! @param [in] policy  The policy passed to *alloc()*; nothing is done without *MEM_NUMA_LOCAL*.
+    //! @return **true** if the buffer was bound.
+    static bool bindToCurrentNode(void *ptr, const size_t bytes, const mem_policy policy)
+    {
+#if defined(__linux__) && defined(SYS_getcpu)
+        if (!ptr || !(policy & MEM_NUMA_LOCAL) || isUnmapped(ptr, false))
+            return false;
+
+        const size_t len = mappedBytes(bytes, policy);
+        unsigned int cpu = 0;
+        unsigned int node = 0;
+        unsigned long mask[NODE_MASK_WORDS] {};
+        constexpr size_t bits = 8 * sizeof(unsigned long);
+
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) || (node >= NODE_MASK_WORDS * bits))
+        {
+            ++counters().numaFailed;
+            return false;
+        }
+
+        mask[node / bits] = 1UL << (node % bits);
+
+        if (syscall(SYS_mbind, ptr, len, MPOL_PREFERRED, mask, NODE_MASK_WORDS * bits, MPOL_MF_MOVE))
+        {
+            ++counters().numaFailed;
+            return false;
+        }
+
+        // Fault the pages in under the new policy. MADV_POPULATE_WRITE leaves the contents alone;
+        // before Linux 5.14 touch each page with an atomic add of zero, which does the same.
+        if (madvise(ptr, len, MADV_POPULATE_WRITE))
+        {
+            for (size_t off=0;off < len;off += pageSize())
+                __atomic_fetch_add(static_cast<uint8_t*>(ptr) + off, 0, __ATOMIC_RELAXED);
+        }
+
+        ++counters().numaConsumer;
+        return true;
+#else
+        (void)ptr;
+        (void)bytes;
+        (void)policy;
+        return false;
+#endif
+    }
+
+    //! Get the size of a regular page.
+    static size_t pageSize()
+    {
+#ifdef __linux__
+        static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+#else
+        return 4096;
+#endif
+    }
+
+    //! Get the counts of what was granted so far.
+    static void getStats(page_alloc_stats &stats)
+    {
+        auto &c = counters();
+
+        stats.hugeTlb = c.hugeTlb;
+        stats.transparent = c.transparent;
+        stats.smallPages = c.smallPages;
+        stats.belowMin = c.belowMin;
+        stats.numaLocal = c.numaLocal;
+        stats.numaFailed = c.numaFailed;
+        stats.numaConsumer = c.numaConsumer;
+        stats.mirrored = c.mirrored;
+        stats.unmapped = c.unmapped;
+    }
+
+private:
+
+    //! \cond
+    // From <numaif.h>, which needs libnuma; the system call itself doesn't.
+    static constexpr int MPOL_PREFERRED = 1;
+    static constexpr int MPOL_LOCAL = 4;
+    static constexpr unsigned int MPOL_MF_MOVE = 1 << 1;
+
+    // Enough for 1024 nodes
+    static constexpr size_t NODE_MASK_WORDS = 1024 / (8 * sizeof(unsigned long));
+
+    // From <linux/mman.h> since Linux 5.14
+#ifndef MADV_POPULATE_WRITE
+    static constexpr int MADV_POPULATE_WRITE = 23;
+#endif
+
+    // From <linux/memfd.h>; memfd_create() is called through syscall() so older C libraries work.
+    static constexpr unsigned int MEMFD_CLOEXEC = 1;
+
+    struct stat_counters
+    {
+        std::atomic<uint32_t> hugeTlb;
+        std::atomic<uint32_t> transparent;
+        std::atomic<uint32_t> smallPages;
+        std::atomic<uint32_t> belowMin;
+        std::atomic<uint32_t> numaLocal;
+        std::atomic<uint32_t> numaFailed;
+        std::atomic<uint32_t> numaConsumer;
+        std::atomic<uint32_t> mirrored;
+        std::atomic<uint32_t> unmapped;
+    };
+
+    // The buffers from the math library allocator which alloc() fell back to. They're rare, so the
+    // list is only searched when it isn't empty.
+    struct unmapped_list
+    {
+        std::mutex mtx;
+        std::vector<void*> ptrs;
+        std::atomic<size_t> count;
+    };
+
+    static unmapped_list& unmappedList()
+    {
+        static unmapped_list l {};
+        return l;
+    }
+
+    static void* allocUnmapped(const size_t bytes)
+    {
+        void *ptr = rm_math::rm_malloc<uint8_t>(bytes);
+
+        if (ptr)
+        {
+            auto &l = unmappedList();
+            std::lock_guard<std::mutex> lck(l.mtx);
+
+            l.ptrs.push_back(ptr);
+            l.count.store(l.ptrs.size(), std::memory_order_relaxed);
+            ++counters().unmapped;
+        }
+
+        return ptr;
+    }
+
+    // Is *ptr* from allocUnmapped()? Take it off the list if *remove*.
+    static bool isUnmapped(void *ptr, const bool remove)
+    {
+        auto &l = unmappedList();
+
+        if (!l.count.load(std::memory_order_relaxed))
+            return false;
+
+        std::lock_guard<std::mutex> lck(l.mtx);
+        auto it = std::find(l.ptrs.begin(), l.ptrs.end(), ptr);
+
+        if (it == l.ptrs.end())
+            return false;
+
+        if (remove)
+        {
+            l.ptrs.erase(it);
+            l.count.store(l.ptrs.size(), std::memory_order_relaxed);
+        }
+
+        return true;
+    }
+
+    static stat_counters& counters()
+    {
+        static stat_counters c {};
+        return c;
+    }
+
+    // Huge pages are only used for buffers of at least HUGE_PAGE_MIN.
+    static bool hugePages(const size_t bytes, const mem_policy policy)
+    {
+        return (policy & MEM_HUGE_PAGES) && (bytes >= HUGE_PAGE_MIN);
+    }
+
+    // MAP_HUGETLB needs the length to be a multiple of the huge page size; so does a transparent
+    // huge page mapping to be fully backed. The kernel rounds anything else up to a page.
+    static size_t mappedBytes(const size_t bytes, const mem_policy policy)
+    {
+        if (!hugePages(bytes, policy))
+            return bytes ? bytes : 1;
+
+        return ((bytes ? bytes : 1) + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+    }
+    //! \endcond
+};
+
+}
@@ -9,6 +9,7 @@
 #include <deque>
 
 #include "aligned-ptr.h"
+#include "shared-block.h"
 #include "rm-math.h"
 
 namespace util {
@@ -24,6 +25,10 @@ namespace util {
  * in the same thread. This can be useful if you use *GNU Radio* to test your blocks. The unit of
  * data is **blocks** rather than individual samples so contructing a port of size **N** implies
  * that the queue will hold **N** blocks of samples of varying lengths.
+ *
+ * The queue holds *shared_block* references so a block which also goes to other consumers, e.g., a
+ * ZMQ publisher, is never copied into the port. A block moved in as an *aligned_ptr* is handed back
+ * out without a copy as well unless someone else still holds it.
  */
 
 template<typename T>
@@ -56,20 +61,48 @@ public:
             if (m_SampleBlockList.size() == m_MaxSize)
                 m_SampleBlockList.pop_back();
 
-            m_SampleBlockList.push_front(std::move(samples));
+            m_SampleBlockList.push_front(shared_block<T> { std::move(samples) });
         }
         else
             samples.clear();
     }
 
+    //! Send a shared block to the port. Only a reference is queued.
+    //! @param [in] samples The block of samples to insert into the queue.
+    void produce(const shared_block<T> &samples)
+    {
+        if (m_MaxSize)
+        {
+            std::lock_guard<std::mutex> lck(m_Mtx);
+
+            if (m_SampleBlockList.size() == m_MaxSize)
+                m_SampleBlockList.pop_back();
+
+            m_SampleBlockList.push_front(samples);
+        }
+    }
+
     //! Read the block of data at the queue tail. 
     //! @param [out] samples An empty *aligned_ptr* type. Note that this uses move semantics.
     void consume(aligned_ptr<T> &samples)
     {
+        std::lock_guard<std::mutex> lck(m_Mtx);
+
         if (m_SampleBlockList.size())
         {
-           std::lock_guard<std::mutex> lck(m_Mtx);
+           m_SampleBlockList.back().take(samples);
+           m_SampleBlockList.pop_back();
+        }
+    }
+
+    //! Read the block of data at the queue tail without copying it.
+    //! @param [out] samples Receives the reference to the block.
+    void consume(shared_block<T> &samples)
+    {
+        std::lock_guard<std::mutex> lck(m_Mtx);
 
+        if (m_SampleBlockList.size())
+        {
            samples = std::move(m_SampleBlockList.back());
            m_SampleBlockList.pop_back();
         }
@@ -94,6 +127,6 @@ private:
     size_t m_MaxSize;
 
     std::mutex m_Mtx;
-    std::deque<aligned_ptr<T>> m_SampleBlockList;
+    std::deque<shared_block<T>> m_SampleBlockList;
 };
 }
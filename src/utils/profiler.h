@@ -0,0 +1,196 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+#include "timer.h"
+#include "histogram.h"
+
+namespace util {
+
+/*! \brief Profiling Results
+ *
+ * A snapshot of the results collected by a *profiler* instance. All times are in nanoseconds.
+ */
+
+struct profile_stats
+{
+    //! The number of calls profiled.
+    uint64_t calls;
+
+    //! The total processing time of all calls.
+    uint64_t totalNs;
+
+    //! The shortest processing time of a call.
+    uint64_t minNs;
+
+    //! The longest processing time of a call.
+    uint64_t maxNs;
+
+    //! The median processing time (bin upper bound, see *histogram*).
+    uint64_t p50Ns;
+
+    //! The 90th percentile processing time (bin upper bound, see *histogram*).
+    uint64_t p90Ns;
+
+    //! The 99th percentile processing time (bin upper bound, see *histogram*).
+    uint64_t p99Ns;
+
+    //! The total number of samples going in.
+    uint64_t samplesIn;
+
+    //! The total number of samples coming out.
+    uint64_t samplesOut;
+
+    //! The average processing time of a call.
+    double avgNs() const { return calls ? static_cast<double>(totalNs) / calls : 0.0; }
+
+    //! The throughput in millions of input samples per second of processing time. For sources,
+    //! which have no input, this uses the output samples.
+    double msps() const
+    {
+        uint64_t samples = samplesIn ? samplesIn : samplesOut;
+        return totalNs ? (samples * 1.0e3) / totalNs : 0.0;
+    }
+};
+
+//! \cond
+
+// Collects timing and sample counts of repeated calls. The disabled version compiles away
+// the same as util::trace<false>.
+template<bool enable = false>
+class profiler
+{
+public:
+
+    using mark_t = int;
+
+    mark_t start() { return 0; }
+    static mark_t at(const timer::timer_t &t) { return 0; }
+    void stop(mark_t mark, size_t samplesIn, size_t samplesOut) { }
+    uint64_t lap(mark_t &mark) { return 0; }
+    void record(uint64_t ns, size_t samplesIn, size_t samplesOut) { }
+    void get(profile_stats &s) const { s = profile_stats { }; }
+    void reset() { }
+};
+
+template<>
+class profiler<true>
+{
+public:
+
+    using mark_t = timer::timer_t;
+
+    profiler()
+    {
+        reset();
+    }
+
+    profiler(const profiler &) = delete;
+    profiler& operator=(const profiler &) = delete;
+
+    // Embedded profilers move with their owner, e.g., a link while the chain is being built.
+    // Like reset(), only while the profiled code is idle.
+    profiler(profiler &&other)
+    {
+        m_Calls = other.m_Calls.load(std::memory_order_relaxed);
+        m_TotalNs = other.m_TotalNs.load(std::memory_order_relaxed);
+        m_MinNs = other.m_MinNs.load(std::memory_order_relaxed);
+        m_MaxNs = other.m_MaxNs.load(std::memory_order_relaxed);
+        m_SamplesIn = other.m_SamplesIn.load(std::memory_order_relaxed);
+        m_SamplesOut = other.m_SamplesOut.load(std::memory_order_relaxed);
+        m_Hist.assign(other.m_Hist);
+    }
+
+    mark_t start()
+    {
+        return timer::StartTimer();
+    }
+
+    // A mark for a time taken elsewhere, e.g., when a sample block was captured.
+    static mark_t at(const timer::timer_t &t)
+    {
+        return t;
+    }
+
+    // Only one thread may call this for a given instance; any thread may call get().
+    void stop(mark_t mark, size_t samplesIn, size_t samplesOut)
+    {
+        record(timer::EndTimerNs(mark), samplesIn, samplesOut);
+    }
+
+    // The time since *mark*, which is moved up to now, for a call made of several pieces; add the
+    // laps up and record() the total.
+    uint64_t lap(mark_t &mark)
+    {
+        const mark_t now = timer::StartTimer();
+        const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - mark).count();
+
+        mark = now;
+        return ns;
+    }
+
+    // Record a call which took *ns* nanoseconds. The same rules as stop().
+    void record(uint64_t ns, size_t samplesIn, size_t samplesOut)
+    {
+        m_Calls.store(m_Calls.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_TotalNs.store(m_TotalNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+        m_SamplesIn.store(m_SamplesIn.load(std::memory_order_relaxed) + samplesIn, std::memory_order_relaxed);
+        m_SamplesOut.store(m_SamplesOut.load(std::memory_order_relaxed) + samplesOut, std::memory_order_relaxed);
+
+        if (ns < m_MinNs.load(std::memory_order_relaxed))
+            m_MinNs.store(ns, std::memory_order_relaxed);
+
+        if (ns > m_MaxNs.load(std::memory_order_relaxed))
+            m_MaxNs.store(ns, std::memory_order_relaxed);
+
+        m_Hist.add(ns);
+    }
+
+    void get(profile_stats &s) const
+    {
+        s.calls = m_Calls.load(std::memory_order_relaxed);
+        s.totalNs = m_TotalNs.load(std::memory_order_relaxed);
+        s.minNs = s.calls ? m_MinNs.load(std::memory_order_relaxed) : 0;
+        s.maxNs = m_MaxNs.load(std::memory_order_relaxed);
+
+        // The bins are coarser than the extremes so keep the percentiles within them.
+        s.p50Ns = std::max(std::min(m_Hist.percentile(0.50), s.maxNs), s.minNs);
+        s.p90Ns = std::max(std::min(m_Hist.percentile(0.90), s.maxNs), s.minNs);
+        s.p99Ns = std::max(std::min(m_Hist.percentile(0.99), s.maxNs), s.minNs);
+        s.samplesIn = m_SamplesIn.load(std::memory_order_relaxed);
+        s.samplesOut = m_SamplesOut.load(std::memory_order_relaxed);
+    }
+
+    // Not synchronized with stop(); only call this while the profiled code is idle.
+    void reset()
+    {
+        m_Calls = 0;
+        m_TotalNs = 0;
+        m_MinNs = UINT64_MAX;
+        m_MaxNs = 0;
+        m_SamplesIn = 0;
+        m_SamplesOut = 0;
+        m_Hist.reset();
+    }
+
+private:
+
+    std::atomic<uint64_t> m_Calls;
+    std::atomic<uint64_t> m_TotalNs;
+    std::atomic<uint64_t> m_MinNs;
+    std::atomic<uint64_t> m_MaxNs;
+    std::atomic<uint64_t> m_SamplesIn;
+    std::atomic<uint64_t> m_SamplesOut;
+
+    histogram m_Hist;
+};
+
+//! \endcond
+
+}
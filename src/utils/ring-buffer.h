@@ -1,21 +1,115 @@
 #pragma once
 
-#include <mutex>
 #include <thread>
 #include <memory>
-#include <functional>
 #include <type_traits>
 #include <atomic>
+#include <algorithm>
+#include <cstring>
 #include <cassert>
 
 #include "timer.h"
 #include "rm-math.h"
+#include "page-alloc.h"
+#include "aligned-span.h"
+#include "spsc-queue.h"
+#include "wait-event.h"
+#include "histogram.h"
 
 namespace util {
 
+//! Diagnostic structure returned in a call to *ring_buffer::diagnostics()*. It is the same
+//! for every sample type so diagnostics can be collected without knowing the type.
+struct ring_buffer_diag
+{
+    //! The number of times the buffer was full and the caller had to wait.
+    uint32_t    fullCount;
+    //! The number of times the buffer contained less than the requested read amount;
+    uint32_t    emptyCount;
+    //! The number of samples *RB_FULL_DROP_NEWEST* threw away because the buffer was full.
+    uint64_t    droppedNewest;
+    //! The number of samples *RB_FULL_OVERWRITE_OLDEST* overwrote before they were read.
+    uint64_t    overwritten;
+};
+
+//! A snapshot of the telemetry of a *ring_buffer*, see *ring_buffer::telemetry()*. Like the diag
+//! structure it's the same for every sample type.
+struct ring_buffer_telemetry
+{
+    //! The bytes written into the buffer; what was dropped isn't counted.
+    uint64_t    bytesIn;
+    //! The bytes read out of the buffer.
+    uint64_t    bytesOut;
+    //! The number of elements the buffer holds.
+    uint32_t    capacity;
+    //! The most elements the buffer was seen to hold by the fill level samples.
+    uint32_t    highWater;
+    //! The median and 99th percentile of the fill level samples (bin upper bounds, see *histogram*,
+    //! but no more than the capacity).
+    uint64_t    fillP50;
+    uint64_t    fillP99;
+    //! The number of times the producer waited and the 99th percentile of how long, in nanoseconds.
+    uint64_t    producerWaits;
+    uint64_t    producerWaitP99Ns;
+    //! The same for the consumer.
+    uint64_t    consumerWaits;
+    uint64_t    consumerWaitP99Ns;
+};
+
+//! How a *ring_buffer* side waits for the other, see *ring_buffer::setWaitMode()*.
+enum ring_wait_mode : uint8_t
+{
+    RB_WAIT_YIELD,  // Sleep for the yield time and check again; zero spins, yielding the CPU.
+    RB_WAIT_EVENT   // Block until the other side makes the room or data available.
+};
+
+//! What a *ring_buffer* producer does when the buffer is full, see *ring_buffer::setFullPolicy()*.
+enum ring_full_policy : uint8_t
+{
+    RB_FULL_BLOCK,              // Wait for the consumer to make room.
+    RB_FULL_DROP_NEWEST,        // Keep what fits and throw away the rest.
+    RB_FULL_OVERWRITE_OLDEST    // Write over the oldest unread samples; the consumer skips past them.
+};
+
 /*! \brief Ring Buffer
  *
- * Implements an SPSC ring buffer using a mod-2 buffer.
+ * Implements a lock-free SPSC ring buffer using a mod-2 buffer. Exactly one thread writes (the
+ * *producer*) and one thread reads (the *consumer*); neither takes a lock. Each side owns its
+ * index, kept on a cache line of its own, and publishes it to the other side with release / acquire
+ * ordering. The indices run freely and are masked on access so all *size* elements can be used.
+ *
+ * A transfer copies as much as fits in at most two *memcpy()* segments, one up to the end of the
+ * buffer and one from its start. A write larger than the free space is done in pieces as the
+ * consumer makes room.
+ *
+ * Instead of copying, the producer can *acquireWrite()* a region, fill it in place and publish it
+ * with *commitWrite()*; the consumer likewise with *acquireRead()* and *commitRead()*. With
+ * *MEM_MIRRORED* the storage is mapped twice back to back (see *page_alloc::allocMirrored()*) so
+ * every region is contiguous in the buffer itself. Otherwise a region which would wrap goes through a
+ * bounce buffer of the side's own, allocated with the buffer. Mirroring needs the size
+ * of the buffer in bytes to be a multiple of the page size; if it can't be done the buffer quietly
+ * falls back, see *isMirrored()*. With *MEM_NUMA_LOCAL* the storage is moved to the consumer's NUMA
+ * node on its first read, see *page_alloc::bindToCurrentNode()*.
+ *
+ * By default a full buffer makes the producer wait. A real-time producer, e.g., a capture thread
+ * which must keep up with the hardware, can instead drop what doesn't fit or overwrite the oldest
+ * unread samples (see *setFullPolicy()*); either way it never waits, a slow consumer loses its own
+ * data and the loss is counted in *diag*. When overwriting, the producer announces the region it's
+ * about to write before touching it, and the consumer checks what it copied wasn't overwritten
+ * meanwhile, skipping ahead if it was. In that mode *acquireRead()* always copies.
+ *
+ * Each buffer keeps telemetry to size it by: the bytes through it, its high-water mark and
+ * histograms of its fill level and of how long either side waited. The producer samples the fill
+ * level whenever it refreshes its cached view of the consumer's index, which it does anyway when the
+ * view shows too little room, i.e., about once per buffer's worth written; when overwriting it needs
+ * no view but refreshes at the same rate for the samples. Wait times are only measured when a side
+ * actually waits. Each counter has a single writer, so any thread can read them
+ * without locking, see *telemetry()*.
+ *
+ * By default a side which has to wait sleeps for the yield time and checks again, so it may
+ * oversleep by up to the yield time; a yield time of zero spins, which suits a thread with a core
+ * to itself. With *RB_WAIT_EVENT* it blocks instead (on a futex on Linux) and is woken as soon as
+ * the room or data it asked for is there.
 */
 
 template <typename T>
@@ -27,32 +121,60 @@ class ring_buffer
 public:
 
     //! Diagnostic structure returned in a call to *diagnostics()*.
-    struct diag
-    {
-        //! The number of times the buffer was full and the caller had to wait.
-        uint32_t    fullCount;
-        //! The number of times the buffer contained less than the requested read amount;
-        uint32_t    emptyCount;
-    };
+    using diag = ring_buffer_diag;
 
     //! Create an instance which uses dynamic memory for the buffer.
-    //! @param [in] exp         Exponent of the base 2 radix which determines the buffer size.
+    //! @param [in] size        The number of elements the buffer will hold. This must be mod-2.
     //! @param [in] yieldTime   Time in microseconds to yield while waiting until the amount meets the transfer criteria.
-    ring_buffer(const uint32_t size, const uint32_t yieldTime = 1000) :
+    //! @param [in] policy      How the buffer is allocated, e.g., in huge pages for a wideband capture;
+    //!                         see *util::page_alloc*. Add *MEM_MIRRORED* for contiguous regions.
+    ring_buffer(const uint32_t size, const uint32_t yieldTime = 1000, const mem_policy policy = MEM_DEFAULT) :
                 m_Capacity { size },
                 m_Mask { m_Capacity - 1 },
                 m_YieldTime { yieldTime },
-                m_StaticBuff { nullptr },
-                m_WriteIdx { 0 },
-                m_ReadIdx { 0 },
+                m_Policy { policy },
+                m_Buff { nullptr },
+                m_Owned { true },
+                m_Mirrored { false },
+                m_WaitMode { RB_WAIT_YIELD },
+                m_FullPolicy { RB_FULL_BLOCK },
+                m_WriteBounce { nullptr },
+                m_ReadBounce { nullptr },
                 m_Abort { 0 },
+                m_WriteIdx { 0 },
+                m_ClaimIdx { 0 },
+                m_ReadCache { 0 },
                 m_WaitForNotFullCount { 0 },
-                m_WaitForAmtCount { 0 }
+                m_WriteAcquired { 0 },
+                m_WriteRoom { 0 },
+                m_DroppedNewest { 0 },
+                m_BytesIn { 0 },
+                m_HighWater { 0 },
+                m_ReadIdx { 0 },
+                m_WriteCache { 0 },
+                m_WaitForAmtCount { 0 },
+                m_ReadAcquired { 0 },
+                m_Overwritten { 0 },
+                m_BytesOut { 0 },
+                m_ReadBound { false },
+                m_WantIdx { 0 }
     {
         assert((size > 0) && !(size & (size - 1)));
-        m_DynamicBuff = std::make_unique<T[]>(m_Capacity);
-        m_ReadFunc = std::bind(&ring_buffer::dynamicRead, this, std::placeholders::_1, std::placeholders::_2);
-        m_WriteFunc = std::bind(&ring_buffer::dynamicWrite, this, std::placeholders::_1, std::placeholders::_2);
+
+        if (m_Policy & MEM_MIRRORED)
+        {
+            m_Policy = static_cast<mem_policy>(m_Policy & ~MEM_MIRRORED);
+            m_Buff = static_cast<T*>(page_alloc::allocMirrored(m_Capacity * sizeof(T), m_Policy));
+            m_Mirrored = (m_Buff != nullptr);
+        }
+
+        if (!m_Buff)
+            m_Buff = static_cast<T*>(page_alloc::alloc(m_Capacity * sizeof(T), m_Policy));
+
+        assert(m_Buff);
+
+        if (!m_Mirrored)
+            allocBounce();
     }
 
     //! Create an instance which uses a user supplied buffer. Primarily for statically declared buffers.
@@ -60,20 +182,53 @@ public:
     //! @param [in] size        The number of elements the buffer will hold where each element is sizeof(T).
     //! @param [in] yieldTime   Time in microseconds to yield while waiting until the amount meets the transfer criteria.
     //! \note  It is the responsibility of the caller to ensure the buffer size is mod-2.
-    ring_buffer(const T *buff, const uint32_t size, const uint32_t yieldTime = 1000) :
+    ring_buffer(T *buff, const uint32_t size, const uint32_t yieldTime = 1000) :
                 m_Capacity { size },
                 m_Mask { m_Capacity - 1 },
                 m_YieldTime { yieldTime },
-                m_StaticBuff { buff },
-                m_WriteIdx { 0 },
-                m_ReadIdx { 0 },
+                m_Policy { MEM_DEFAULT },
+                m_Buff { buff },
+                m_Owned { false },
+                m_Mirrored { false },
+                m_WaitMode { RB_WAIT_YIELD },
+                m_FullPolicy { RB_FULL_BLOCK },
+                m_WriteBounce { nullptr },
+                m_ReadBounce { nullptr },
                 m_Abort { 0 },
+                m_WriteIdx { 0 },
+                m_ClaimIdx { 0 },
+                m_ReadCache { 0 },
                 m_WaitForNotFullCount { 0 },
-                m_WaitForAmtCount { 0 }
+                m_WriteAcquired { 0 },
+                m_WriteRoom { 0 },
+                m_DroppedNewest { 0 },
+                m_BytesIn { 0 },
+                m_HighWater { 0 },
+                m_ReadIdx { 0 },
+                m_WriteCache { 0 },
+                m_WaitForAmtCount { 0 },
+                m_ReadAcquired { 0 },
+                m_Overwritten { 0 },
+                m_BytesOut { 0 },
+                m_ReadBound { false },
+                m_WantIdx { 0 }
     {
         assert((size > 0) && !(size & (size - 1)));
-        m_ReadFunc = std::bind(&ring_buffer::staticRead, this, std::placeholders::_1, std::placeholders::_2);
-        m_WriteFunc = std::bind(&ring_buffer::staticWrite, this, std::placeholders::_1, std::placeholders::_2);
+        allocBounce();
+    }
+
+    ~ring_buffer()
+    {
+        if (m_Mirrored)
+            page_alloc::releaseMirrored(m_Buff, m_Capacity * sizeof(T));
+        else if (m_Owned)
+            page_alloc::release(m_Buff, m_Capacity * sizeof(T), m_Policy);
+
+        if (m_WriteBounce)
+            page_alloc::release(m_WriteBounce, m_Capacity * sizeof(T), MEM_DEFAULT);
+
+        if (m_ReadBounce)
+            page_alloc::release(m_ReadBounce, m_Capacity * sizeof(T), MEM_DEFAULT);
     }
 
     ring_buffer() = delete;
@@ -84,45 +239,264 @@ public:
     ring_buffer(ring_buffer&&) = delete;
     ring_buffer& operator=(ring_buffer&&) = delete;
 
-    //! Write data to the ring buffer. This will block until all data is written.
+    //! Set how the producer and consumer wait for each other. Set it before either starts.
+    //! @param [in] mode  The wait mode. The default is *RB_WAIT_YIELD*.
+    void setWaitMode(const ring_wait_mode mode) { m_WaitMode = mode; }
+
+    //! Set what the producer does when the buffer is full. Set it before either side starts.
+    //! *write()* and *acquireWrite()* agree: with *RB_FULL_DROP_NEWEST* both keep what fits and
+    //! count the rest in *droppedNewest*.
+    //! @param [in] policy  The policy. The default is *RB_FULL_BLOCK*.
+    void setFullPolicy(const ring_full_policy policy)
+    {
+        m_FullPolicy = policy;
+
+        // Dropping and overwriting stage regions even in mirrored storage
+        if (m_FullPolicy != RB_FULL_BLOCK)
+            allocBounce();
+    }
+
+    //! Write data to the ring buffer. This will block until all data is written unless the full
+    //! policy says otherwise. Only the producer may call this.
     //! @param [in] buff  The data to write.
     //! @param [in] sz    The number of elements to write.
     void write(const T *buff, const size_t sz)
     {
-        if (m_Abort) return;
+        size_t done = 0;
+
+        while(done < sz)
+        {
+            uint32_t space = m_Capacity;
+
+            if (m_FullPolicy == RB_FULL_BLOCK)
+                space = waitNotFull();
+            else if (m_FullPolicy == RB_FULL_DROP_NEWEST)
+            {
+                space = freeSpace(1);
+
+                if (!space)
+                {
+                    dropNewest(sz - done);
+                    return;
+                }
+            }
+
+            if (isAborted()) return;
+
+            const uint32_t n = static_cast<uint32_t>(std::min<size_t>(space, sz - done));
+            const uint32_t idx = m_WriteIdx.load(std::memory_order_relaxed);
+
+            if (m_FullPolicy == RB_FULL_OVERWRITE_OLDEST)
+                claim(idx + n);
 
-        m_Mtx.lock();
-        m_WriteFunc(buff, sz);
-        m_Mtx.unlock();
+            copyIn(idx, buff + done, n);
+            m_WriteIdx.store(idx + n, std::memory_order_release);
+
+            if ((m_WaitMode == RB_WAIT_EVENT) && hasWanted(idx + n))
+                m_DataEvent.notify();
+
+            recordWrite(idx + n, n);
+
+            done += n;
+        }
     }
 
-    //! Read data from the ring buffer. This will block until the requested amount is read.
+    //! Read data from the ring buffer. This will block until the requested amount is read. Only
+    //! the consumer may call this.
     //! @param [in]  buff  The buffer to place the read data in.
-    //! @param [in]  sz    The number of elements to read.
+    //! @param [in]  sz    The number of elements to read. It can't be more than the buffer holds.
     void read(T *buff, const size_t sz)
     {
-        if (m_Abort) return;
+        assert(sz <= m_Capacity);
 
-        m_Mtx.lock();
-        m_ReadFunc(buff, sz);
-        m_Mtx.unlock();
+        bindReader();
+
+        uint32_t idx;
+
+        if (!fetch(buff, static_cast<uint32_t>(sz), idx))
+            return;
+
+        m_ReadIdx.store(idx + static_cast<uint32_t>(sz), std::memory_order_release);
+
+        if (m_WaitMode == RB_WAIT_EVENT)
+            m_SpaceEvent.notify();
+
+        recordRead(sz);
     }
 
-    //! Get the current diagnostic values.
+    //! Producer side. Get a region of *n* elements to fill in place, waiting for the room. Publish
+    //! it with *commitWrite()* before acquiring another or calling *write()*. With
+    //! *RB_FULL_DROP_NEWEST* it doesn't wait; like *write()*, only what fits is published and the
+    //! rest of the region is dropped.
+    //! @param [in] n   The number of elements. It can't be more than the buffer holds.
+    //! @return The region, or an empty span if the buffer was aborted.
+    aligned_span<T> acquireWrite(const size_t n)
+    {
+        assert(n <= m_Capacity);
+
+        const uint32_t idx = m_WriteIdx.load(std::memory_order_relaxed);
+
+        m_WriteAcquired = static_cast<uint32_t>(n);
+        m_WriteRoom = m_WriteAcquired;
+
+        if (m_FullPolicy == RB_FULL_BLOCK)
+        {
+            if (waitNotFull(m_WriteAcquired) < n)
+                return { };
+        }
+        else if (m_FullPolicy == RB_FULL_DROP_NEWEST)
+        {
+            // Only what fits is kept, the rest of the region is filled and thrown away
+            m_WriteRoom = std::min(freeSpace(m_WriteAcquired), m_WriteAcquired);
+        }
+        else
+            claim(idx + m_WriteAcquired);
+
+        if (isAborted())
+            return { };
+
+        if ((m_WriteRoom == m_WriteAcquired) && !wraps(idx & m_Mask, m_WriteAcquired))
+            return { m_Buff + (idx & m_Mask), n };
+
+        assert(m_WriteBounce);
+        return { m_WriteBounce, n };
+    }
+
+    //! Producer side. Publish the first *n* elements of the region from *acquireWrite()*, or count
+    //! them as dropped if *RB_FULL_DROP_NEWEST* found no room for it.
+    //! @param [in] n   The number of elements filled; at most what was acquired.
+    void commitWrite(const size_t n)
+    {
+        assert(n <= m_WriteAcquired);
+
+        const uint32_t idx = m_WriteIdx.load(std::memory_order_relaxed);
+        const uint32_t keep = std::min(static_cast<uint32_t>(n), m_WriteRoom);
+        const bool bounced = (m_WriteRoom < m_WriteAcquired) || wraps(idx & m_Mask, m_WriteAcquired);
+
+        m_WriteAcquired = 0;
+        m_WriteRoom = 0;
+
+        if (keep < n)
+            dropNewest(n - keep);
+
+        if (!keep)
+            return;
+
+        if (bounced)
+            copyIn(idx, m_WriteBounce, keep);
+
+        m_WriteIdx.store(idx + keep, std::memory_order_release);
+
+        if ((m_WaitMode == RB_WAIT_EVENT) && hasWanted(idx + keep))
+            m_DataEvent.notify();
+
+        recordWrite(idx + keep, keep);
+    }
+
+    //! Consumer side. Get a region of the next *n* elements to process in place, waiting until
+    //! they're there. Release it with *commitRead()* before acquiring another or calling *read()*.
+    //! @param [in] n   The number of elements. It can't be more than the buffer holds.
+    //! @return The region, or an empty span if the buffer was aborted.
+    aligned_span<const T> acquireRead(const size_t n)
+    {
+        assert(n <= m_Capacity);
+
+        bindReader();
+
+        m_ReadAcquired = static_cast<uint32_t>(n);
+
+        // The producer may overwrite anything in place, so take a checked copy
+        if (m_FullPolicy == RB_FULL_OVERWRITE_OLDEST)
+        {
+            assert(m_ReadBounce);
+
+            uint32_t idx;
+
+            if (!fetch(m_ReadBounce, m_ReadAcquired, idx))
+                return { };
+
+            return { m_ReadBounce, n };
+        }
+
+        waitForAmount(m_ReadAcquired);
+        if (isAborted()) return { };
+
+        const uint32_t idx = m_ReadIdx.load(std::memory_order_relaxed);
+        const uint32_t off = idx & m_Mask;
+
+        if (!wraps(off, m_ReadAcquired))
+            return { m_Buff + off, n };
+
+        assert(m_ReadBounce);
+
+        copyOut(idx, m_ReadBounce, m_ReadAcquired);
+        return { m_ReadBounce, n };
+    }
+
+    //! Consumer side. Release the first *n* elements of the region from *acquireRead()* back to the
+    //! producer.
+    //! @param [in] n   The number of elements consumed; at most what was acquired.
+    void commitRead(const size_t n)
+    {
+        assert(n <= m_ReadAcquired);
+
+        m_ReadAcquired = 0;
+        m_ReadIdx.store(m_ReadIdx.load(std::memory_order_relaxed) + static_cast<uint32_t>(n), std::memory_order_release);
+
+        if (m_WaitMode == RB_WAIT_EVENT)
+            m_SpaceEvent.notify();
+
+        recordRead(n);
+    }
+
+    //! Check if the storage is mapped twice so regions never need a bounce buffer.
+    bool isMirrored() const { return m_Mirrored; }
+
+    //! Get the current diagnostic values. This may be called from any thread.
     //! @param [out] d  Reference to a diagnotic structure.
     void diagnostics(diag &d)
     {
-        std::lock_guard<std::mutex> lck(m_Mtx);
-        d.fullCount = m_WaitForNotFullCount;
-        d.emptyCount = m_WaitForAmtCount;
+        d.fullCount = m_WaitForNotFullCount.load(std::memory_order_relaxed);
+        d.emptyCount = m_WaitForAmtCount.load(std::memory_order_relaxed);
+        d.droppedNewest = m_DroppedNewest.load(std::memory_order_relaxed);
+        d.overwritten = m_Overwritten.load(std::memory_order_relaxed);
+    }
+
+    //! Get a snapshot of the telemetry. This may be called from any thread; values being updated
+    //! meanwhile may be off by the transfer in flight.
+    //! @param [out] t  Reference to a telemetry structure.
+    void telemetry(ring_buffer_telemetry &t) const
+    {
+        t.bytesIn = m_BytesIn.load(std::memory_order_relaxed);
+        t.bytesOut = m_BytesOut.load(std::memory_order_relaxed);
+        t.capacity = m_Capacity;
+        t.highWater = m_HighWater.load(std::memory_order_relaxed);
+        t.fillP50 = std::min<uint64_t>(m_FillHist.percentile(0.5), m_Capacity);
+        t.fillP99 = std::min<uint64_t>(m_FillHist.percentile(0.99), m_Capacity);
+        t.producerWaits = m_ProducerWaitHist.count();
+        t.producerWaitP99Ns = m_ProducerWaitHist.percentile(0.99);
+        t.consumerWaits = m_ConsumerWaitHist.count();
+        t.consumerWaitP99Ns = m_ConsumerWaitHist.percentile(0.99);
     }
 
-    //! Return the current number of elements in the buffer
+    //! Get the histogram of the fill level samples. It may be read from any thread.
+    const histogram& fillHistogram() const { return m_FillHist; }
+
+    //! Get the histogram of the producer's waits, in nanoseconds. It may be read from any thread.
+    const histogram& producerWaitHistogram() const { return m_ProducerWaitHist; }
+
+    //! Get the histogram of the consumer's waits, in nanoseconds. It may be read from any thread.
+    const histogram& consumerWaitHistogram() const { return m_ConsumerWaitHist; }
+
+    //! Return the current number of elements in the buffer. This is only a snapshot if called
+    //! while the buffer is active.
     //! @return The number of elements in the buffer.
     uint32_t amount()
     {
-        std::lock_guard<std::mutex> lck(m_Mtx);
-        return getAmount();
+        const uint32_t rd = m_ReadIdx.load(std::memory_order_acquire);
+
+        // Overwriting can put the producer more than a buffer ahead until the consumer skips
+        return std::min(m_WriteIdx.load(std::memory_order_acquire) - rd, m_Capacity);
     }
 
     //! Set the ring_buffer instance to the abort state. This should only be
@@ -137,133 +511,358 @@ public:
     //!                   Passing in zero in will have of effect.
     void abort(int code = -1)
     {
-        std::lock_guard<std::mutex> lck(m_Mtx);
-        m_Abort = code;
+        m_Abort.store(code, std::memory_order_release);
+
+        // Wake either side if it's blocked
+        m_DataEvent.notify();
+        m_SpaceEvent.notify();
     }
 
     //! Get the current abort code.
     //! @return The abort code.
     int abortcode()
     {
-        std::lock_guard<std::mutex> lck(m_Mtx);
-        return m_Abort;
+        return m_Abort.load(std::memory_order_acquire);
     }
 
 private:
 
-    using write_func = void(const T *buff, const size_t sz);
-    using read_func  = void(T *buff, const size_t sz);
-
-    std::function<write_func> m_WriteFunc;
-    std::function<read_func>  m_ReadFunc;
-
+    // Read mostly; set at construction
     uint32_t    m_Capacity;
     uint32_t    m_Mask;
     uint32_t    m_YieldTime;
+    mem_policy  m_Policy;
+
+    T*          m_Buff;
+    bool        m_Owned;
+    bool        m_Mirrored;
+    ring_wait_mode m_WaitMode;
+    ring_full_policy m_FullPolicy;
+
+    // Regions of unmirrored storage which would wrap are staged here. They're allocated up front so
+    // acquiring a region never allocates, but not touched until used.
+    T*          m_WriteBounce;
+    T*          m_ReadBounce;
+
+    std::atomic<int> m_Abort;
+
+    // Producer side: its index, the end of the region it's overwriting, its last look at the
+    // consumer's index, its wait count, what it dropped and its telemetry
+    uint8_t m_Pad0[CACHE_LINE_SIZE];
+    std::atomic<uint32_t> m_WriteIdx;
+    std::atomic<uint32_t> m_ClaimIdx;
+    uint32_t m_ReadCache;
+    std::atomic<uint32_t> m_WaitForNotFullCount;
+    uint32_t m_WriteAcquired;
+    uint32_t m_WriteRoom;
+    std::atomic<uint64_t> m_DroppedNewest;
+    std::atomic<uint64_t> m_BytesIn;
+    std::atomic<uint32_t> m_HighWater;
+    uint8_t m_Pad1[CACHE_LINE_SIZE - 7 * sizeof(uint32_t) - 2 * sizeof(uint64_t)];
+
+    // Consumer side: the same the other way around
+    std::atomic<uint32_t> m_ReadIdx;
+    uint32_t m_WriteCache;
+    std::atomic<uint32_t> m_WaitForAmtCount;
+    uint32_t m_ReadAcquired;
+    std::atomic<uint64_t> m_Overwritten;
+    std::atomic<uint64_t> m_BytesOut;
+    bool m_ReadBound;
+    uint8_t m_Pad2[CACHE_LINE_SIZE - 4 * sizeof(uint32_t) - 2 * sizeof(uint64_t) - sizeof(bool)];
+
+    // Event mode: the consumer blocks on m_DataEvent until the write index reaches m_WantIdx, the
+    // producer on m_SpaceEvent until the consumer frees any room.
+    wait_event m_DataEvent;
+    std::atomic<uint32_t> m_WantIdx;
+    uint8_t m_Pad3[CACHE_LINE_SIZE];
+    wait_event m_SpaceEvent;
+    uint8_t m_Pad4[CACHE_LINE_SIZE];
+
+    // Telemetry histograms; the producer adds to the first two, the consumer to the last.
+    histogram m_FillHist;
+    histogram m_ProducerWaitHist;
+    uint8_t m_Pad5[CACHE_LINE_SIZE];
+    histogram m_ConsumerWaitHist;
+
+    bool isAborted() const
+    {
+        return (m_Abort.load(std::memory_order_relaxed) != 0);
+    }
 
-    std::unique_ptr<T[]>    m_DynamicBuff;
-    const T*                m_StaticBuff;
+    // Allocate the bounce buffers which are still missing.
+    void allocBounce()
+    {
+        if (!m_WriteBounce)
+            m_WriteBounce = static_cast<T*>(page_alloc::alloc(m_Capacity * sizeof(T), MEM_DEFAULT));
 
-    std::mutex m_Mtx;
+        if (!m_ReadBounce)
+            m_ReadBounce = static_cast<T*>(page_alloc::alloc(m_Capacity * sizeof(T), MEM_DEFAULT));
 
-    uint32_t m_WriteIdx;
-    uint32_t m_ReadIdx;
+        assert(m_WriteBounce && m_ReadBounce);
+    }
 
-    int m_Abort;
+    // Consumer side. With MEM_NUMA_LOCAL the pages land on the producer's node since it writes them
+    // first; move the storage to the consumer's node before its first read. A mirrored buffer
+    // never has huge pages.
+    void bindReader()
+    {
+        if (m_ReadBound)
+            return;
 
-    uint32_t m_WaitForNotFullCount;
-    uint32_t m_WaitForAmtCount;
+        m_ReadBound = true;
 
-    void dynamicWrite(const T *buff, const size_t sz)
+        const mem_policy policy = m_Mirrored ? static_cast<mem_policy>(m_Policy & MEM_NUMA_LOCAL) : m_Policy;
+        page_alloc::bindToCurrentNode(m_Buff, m_Capacity * sizeof(T), policy);
+    }
+
+    // Check if a region of *n* elements at offset *off* runs past the end of unmirrored storage.
+    bool wraps(const uint32_t off, const uint32_t n) const
     {
-        for (size_t i=0;i < sz;i++)
-        {
-            waitNotFull();
-            if (m_Abort) return;
+        return (!m_Mirrored && ((off + n) > m_Capacity));
+    }
 
-            m_DynamicBuff[m_WriteIdx++] = buff[i];
-            m_WriteIdx &= m_Mask;
-        }
+    // Copy *n* elements into the buffer at *idx*; the part past the end wraps to the start, which
+    // mirrored storage does by itself.
+    void copyIn(const uint32_t idx, const T *src, const uint32_t n)
+    {
+        const uint32_t off = idx & m_Mask;
+        const uint32_t first = m_Mirrored ? n : std::min(n, m_Capacity - off);
+
+        std::memcpy(m_Buff + off, src, first * sizeof(T));
+
+        if (n > first)
+            std::memcpy(m_Buff, src + first, (n - first) * sizeof(T));
     }
 
-    void staticWrite(const T *buff, const size_t sz)
+    // Copy *n* elements out of the buffer from *idx*, the same way.
+    void copyOut(const uint32_t idx, T *dst, const uint32_t n)
     {
-        for (size_t i=0;i < sz;i++)
-        {
-            waitNotFull();
-            if (m_Abort) return;
+        const uint32_t off = idx & m_Mask;
+        const uint32_t first = m_Mirrored ? n : std::min(n, m_Capacity - off);
 
-            m_StaticBuff[m_WriteIdx++] = buff[i];
-            m_WriteIdx &= m_Mask;
-        }
+        std::memcpy(dst, m_Buff + off, first * sizeof(T));
+
+        if (n > first)
+            std::memcpy(dst + first, m_Buff, (n - first) * sizeof(T));
     }
 
-    void dynamicRead(T *buff, const size_t sz)
+    // Producer side. Get the free space, refreshing the consumer's index only when the last look
+    // shows less than *need*.
+    uint32_t freeSpace(const uint32_t need)
     {
-        waitForAmount(sz);
-        if (m_Abort) return;
+        const uint32_t wr = m_WriteIdx.load(std::memory_order_relaxed);
+        const uint32_t space = m_Capacity - (wr - m_ReadCache);
 
-        for (size_t i=0;i < sz;i++)
-        {
-            buff[i] = m_DynamicBuff[m_ReadIdx++];
-            m_ReadIdx &= m_Mask;
-        }
+        if (space >= need)
+            return space;
+
+        refreshReadCache(wr);
+        return m_Capacity - (wr - m_ReadCache);
+    }
+
+    // Producer side. Get the free space and wait if there's less than *need*.
+    uint32_t waitNotFull(const uint32_t need = 1)
+    {
+        const uint32_t wr = m_WriteIdx.load(std::memory_order_relaxed);
+        uint32_t space = freeSpace(need);
+
+        if (space >= need)
+            return space;
+
+        m_WaitForNotFullCount.store(m_WaitForNotFullCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        auto start = timer::StartTimer();
+
+        space = blockNotFull(wr, need);
+        m_ProducerWaitHist.add(timer::EndTimerNs(start));
+
+        return space;
     }
 
-    void staticRead(T *buff, const size_t sz)
+    // Producer side. Wait until there's at least *need* free; zero if aborted meanwhile.
+    uint32_t blockNotFull(const uint32_t wr, const uint32_t need)
     {
-        waitForAmount(sz);
-        if (m_Abort) return;
+        uint32_t space;
 
-        for (size_t i=0;i < sz;i++)
+        while(1)
         {
-            buff[i] = m_StaticBuff[m_ReadIdx++];
-            m_ReadIdx &= m_Mask;
+            if (m_WaitMode == RB_WAIT_EVENT)
+            {
+                auto key = m_SpaceEvent.prepareWait();
+
+                m_ReadCache = m_ReadIdx.load(std::memory_order_acquire);
+                space = m_Capacity - (wr - m_ReadCache);
+
+                if (isAborted() || (space >= need))
+                {
+                    m_SpaceEvent.cancelWait();
+                    return isAborted() ? 0 : space;
+                }
+
+                m_SpaceEvent.wait(key);
+            }
+            else
+                timer::sleepUs(m_YieldTime);
+
+            m_ReadCache = m_ReadIdx.load(std::memory_order_acquire);
+            space = m_Capacity - (wr - m_ReadCache);
+
+            if (isAborted())
+                return 0;
+
+            if (space >= need)
+                return space;
         }
     }
 
-    void waitNotFull()
+    // Producer side. Count a write of *n* elements which took the write index to *wr*. When
+    // overwriting nothing else refreshes the view of the consumer's index, so do it here once the
+    // view is a buffer behind.
+    void recordWrite(const uint32_t wr, const uint32_t n)
     {
-        if (!isFull())
-            return;
+        m_BytesIn.store(m_BytesIn.load(std::memory_order_relaxed) + n * sizeof(T), std::memory_order_relaxed);
+
+        if ((m_FullPolicy == RB_FULL_OVERWRITE_OLDEST) && ((wr - m_ReadCache) >= m_Capacity))
+            refreshReadCache(wr);
+    }
+
+    // Producer side. Refresh the view of the consumer's index and sample the fill level with it.
+    void refreshReadCache(const uint32_t wr)
+    {
+        m_ReadCache = m_ReadIdx.load(std::memory_order_acquire);
+
+        const uint32_t fill = std::min(wr - m_ReadCache, m_Capacity);
+
+        m_FillHist.add(fill);
 
-        ++m_WaitForNotFullCount;
+        if (fill > m_HighWater.load(std::memory_order_relaxed))
+            m_HighWater.store(fill, std::memory_order_relaxed);
+    }
+
+    // Consumer side. Count a read of *n* elements.
+    void recordRead(const size_t n)
+    {
+        m_BytesOut.store(m_BytesOut.load(std::memory_order_relaxed) + n * sizeof(T), std::memory_order_relaxed);
+    }
+
+    // Producer side. Count *n* samples thrown away for want of room.
+    void dropNewest(const size_t n)
+    {
+        m_DroppedNewest.store(m_DroppedNewest.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    // Producer side. Announce writing up to *end* before overwriting anything. The store publishes
+    // the write index before it; the fence keeps the stores to the buffer after it. See *fetch()*.
+    void claim(const uint32_t end)
+    {
+        m_ClaimIdx.store(end, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    // Consumer side. Wait for *amt* elements and copy them to *dst* without releasing them. When
+    // overwriting, skip past whatever the producer has claimed and check again after copying that
+    // none of it was claimed meanwhile. The index read from is returned in *idx*.
+    bool fetch(T *dst, const uint32_t amt, uint32_t &idx)
+    {
         while(1)
         {
-            m_Mtx.unlock();
-            timer::sleepUs(m_YieldTime);
-            m_Mtx.lock();
+            waitForAmount(amt);
+            if (isAborted()) return false;
 
-            if (m_Abort || !isFull())
-                break;
+            idx = m_ReadIdx.load(std::memory_order_relaxed);
+
+            if (m_FullPolicy != RB_FULL_OVERWRITE_OLDEST)
+            {
+                copyOut(idx, dst, amt);
+                return true;
+            }
+
+            if (overrun(idx))
+                continue;
+
+            copyOut(idx, dst, amt);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (!overrun(idx))
+                return true;
         }
     }
 
-    void waitForAmount(const size_t amt)
+    // Consumer side. If the producer has claimed any of the data from *idx* on, skip to the oldest
+    // data it hasn't and count what was lost. A claim is never more than a buffer past the write
+    // index published before it, so the skip can't pass the write index.
+    bool overrun(const uint32_t idx)
+    {
+        const uint32_t oldest = m_ClaimIdx.load(std::memory_order_acquire) - m_Capacity;
+
+        if (static_cast<int32_t>(oldest - idx) <= 0)
+            return false;
+
+        m_Overwritten.store(m_Overwritten.load(std::memory_order_relaxed) + (oldest - idx), std::memory_order_relaxed);
+        m_ReadIdx.store(oldest, std::memory_order_release);
+        m_WriteCache = m_WriteIdx.load(std::memory_order_acquire);
+        return true;
+    }
+
+    // Consumer side. Wait until at least *amt* elements are in the buffer.
+    void waitForAmount(const uint32_t amt)
     {
-        if (getAmount() >= amt)
+        const uint32_t rd = m_ReadIdx.load(std::memory_order_relaxed);
+
+        if ((m_WriteCache - rd) >= amt)
+            return;
+
+        m_WriteCache = m_WriteIdx.load(std::memory_order_acquire);
+
+        if ((m_WriteCache - rd) >= amt)
             return;
 
-        ++m_WaitForAmtCount;
+        m_WaitForAmtCount.store(m_WaitForAmtCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        // Tell the producer how far it has to get before waking us.
+        if (m_WaitMode == RB_WAIT_EVENT)
+            m_WantIdx.store(rd + amt, std::memory_order_relaxed);
+
+        auto start = timer::StartTimer();
+
         while(1)
         {
-            m_Mtx.unlock();
-            timer::sleepUs(m_YieldTime);
-            m_Mtx.lock();
+            if (m_WaitMode == RB_WAIT_EVENT)
+            {
+                auto key = m_DataEvent.prepareWait();
+
+                m_WriteCache = m_WriteIdx.load(std::memory_order_acquire);
 
-            if (m_Abort || (getAmount() >= amt))
+                if (isAborted() || ((m_WriteCache - rd) >= amt))
+                {
+                    m_DataEvent.cancelWait();
+                    break;
+                }
+
+                m_DataEvent.wait(key);
+            }
+            else
+                timer::sleepUs(m_YieldTime);
+
+            m_WriteCache = m_WriteIdx.load(std::memory_order_acquire);
+
+            if (isAborted() || ((m_WriteCache - rd) >= amt))
                 break;
         }
-    }
 
-    bool isFull()
-    {
-        return (((m_WriteIdx + 1) & m_Mask) == m_ReadIdx);
+        m_ConsumerWaitHist.add(timer::EndTimerNs(start));
     }
 
-    uint32_t getAmount()
+    // Producer side. Check if the write index has reached what a blocked consumer asked for. The
+    // indices wrap so compare the distance. The consumer stores its want index and then, after the
+    // fence in prepareWait(), reads the write index; the producer does the opposite, so it needs a
+    // fence of its own between storing the write index and reading the want index. Without it the
+    // producer can see a stale want index, skip the notify() and leave the consumer asleep.
+    bool hasWanted(const uint32_t wr) const
     {
-        return (m_WriteIdx >= m_ReadIdx) ? (m_WriteIdx - m_ReadIdx) : ((m_Capacity - m_ReadIdx) + m_WriteIdx);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        return (static_cast<int32_t>(wr - m_WantIdx.load(std::memory_order_relaxed)) >= 0);
     }
 };
 }
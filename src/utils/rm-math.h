@@ -8,6 +8,9 @@
 #include <volk/volk.h>
 #include <cmath>
 #include <type_traits>
+#include <cassert>
+
+#include "aligned-span.h"
 
 // See the 'using' statement at the bottom to set which library to use; default
 // is Volk.
@@ -115,6 +118,57 @@ struct volk
         volk_32f_s32f_add_32f(out, v1, s, num_points);
     }
 
+    // Span forms of the vector kernels above. The number of points is the size of the output span
+    // and the input spans must hold at least that many.
+    static void dot_prod(float *out, aligned_span<const float> in, aligned_span<const float> taps)
+    {
+        assert(in.size() >= taps.size());
+        dot_prod(out, in.data(), taps.data(), taps.size());
+    }
+
+    static void dot_prod(std::complex<float> *out, aligned_span<const std::complex<float>> in, aligned_span<const float> taps)
+    {
+        assert(in.size() >= taps.size());
+        dot_prod(out, in.data(), taps.data(), taps.size());
+    }
+
+    static void blk_cos(aligned_span<float> out, aligned_span<const float> in)
+    {
+        assert(in.size() >= out.size());
+        blk_cos(out.data(), in.data(), out.size());
+    }
+
+    static void blk_sin(aligned_span<float> out, aligned_span<const float> in)
+    {
+        assert(in.size() >= out.size());
+        blk_sin(out.data(), in.data(), out.size());
+    }
+
+    static void mult_conj(aligned_span<std::complex<float>> out, aligned_span<const std::complex<float>> in,
+                            aligned_span<const std::complex<float>> conjIn)
+    {
+        assert((in.size() >= out.size()) && (conjIn.size() >= out.size()));
+        mult_conj(out.data(), in.data(), conjIn.data(), out.size());
+    }
+
+    static void vect_mult(aligned_span<float> out, aligned_span<const float> v1, aligned_span<const float> v2)
+    {
+        assert((v1.size() >= out.size()) && (v2.size() >= out.size()));
+        vect_mult(out.data(), v1.data(), v2.data(), out.size());
+    }
+
+    static void vect_scaler_mult(aligned_span<float> out, aligned_span<const float> v1, const float s)
+    {
+        assert(v1.size() >= out.size());
+        vect_scaler_mult(out.data(), v1.data(), s, out.size());
+    }
+
+    static void vect_scaler_add(aligned_span<float> out, aligned_span<const float> v1, const float s)
+    {
+        assert(v1.size() >= out.size());
+        vect_scaler_add(out.data(), v1.data(), s, out.size());
+    }
+
     // float rounding to a specified number of fractional digits
     static float round(float value, uint8_t digits);
 
@@ -192,6 +246,57 @@ struct cmsis
     {
     }
 
+    // Span forms of the vector kernels above. The number of points is the size of the output span
+    // and the input spans must hold at least that many.
+    static void dot_prod(float *out, aligned_span<const float> in, aligned_span<const float> taps)
+    {
+        assert(in.size() >= taps.size());
+        dot_prod(out, in.data(), taps.data(), taps.size());
+    }
+
+    static void dot_prod(std::complex<float> *out, aligned_span<const std::complex<float>> in, aligned_span<const float> taps)
+    {
+        assert(in.size() >= taps.size());
+        dot_prod(out, in.data(), taps.data(), taps.size());
+    }
+
+    static void blk_cos(aligned_span<float> out, aligned_span<const float> in)
+    {
+        assert(in.size() >= out.size());
+        blk_cos(out.data(), in.data(), out.size());
+    }
+
+    static void blk_sin(aligned_span<float> out, aligned_span<const float> in)
+    {
+        assert(in.size() >= out.size());
+        blk_sin(out.data(), in.data(), out.size());
+    }
+
+    static void mult_conj(aligned_span<std::complex<float>> out, aligned_span<const std::complex<float>> in,
+                            aligned_span<const std::complex<float>> conjIn)
+    {
+        assert((in.size() >= out.size()) && (conjIn.size() >= out.size()));
+        mult_conj(out.data(), in.data(), conjIn.data(), out.size());
+    }
+
+    static void vect_mult(aligned_span<float> out, aligned_span<const float> v1, aligned_span<const float> v2)
+    {
+        assert((v1.size() >= out.size()) && (v2.size() >= out.size()));
+        vect_mult(out.data(), v1.data(), v2.data(), out.size());
+    }
+
+    static void vect_scaler_mult(aligned_span<float> out, aligned_span<const float> v1, const float s)
+    {
+        assert(v1.size() >= out.size());
+        vect_scaler_mult(out.data(), v1.data(), s, out.size());
+    }
+
+    static void vect_scaler_add(aligned_span<float> out, aligned_span<const float> v1, const float s)
+    {
+        assert(v1.size() >= out.size());
+        vect_scaler_add(out.data(), v1.data(), s, out.size());
+    }
+
     // float rounding to a specified number of fractional digits
     static float round(float value, uint8_t digits);
 
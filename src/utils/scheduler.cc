@@ -0,0 +1,252 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#include "scheduler.h"
+
+using namespace util;
+
+scheduler::scheduler(const uint32_t workers, const uint32_t yieldTime) : m_Active { false }, m_YieldTime { yieldTime }
+{
+    assert(workers > 0);
+
+    for (uint32_t i=0;i < workers;i++)
+        m_Workers.push_back(std::make_unique<worker>());
+}
+
+int scheduler::add(chain &c, std::function<bool()> ready)
+{
+    if (m_Active)
+        return -1;
+
+    m_Tasks.push_back(std::make_unique<task>(&c, std::move(ready)));
+    return static_cast<int>(m_Tasks.size() - 1);
+}
+
+bool scheduler::start()
+{
+    if (m_Tasks.empty() || m_Active)
+        return false;
+
+    for (auto &w : m_Workers)
+    {
+        w->tasks.assign(m_Tasks.size(), 0);
+        w->head = 0;
+        w->count = 0;
+    }
+
+    // Deal the chains out round robin.
+    for (size_t i=0;i < m_Tasks.size();i++)
+    {
+        m_Tasks[i]->queued = timer::StartTimer();
+        push(*m_Workers[i % m_Workers.size()], static_cast<uint32_t>(i));
+    }
+
+    m_Active = true;
+
+    for (size_t i=0;i < m_Workers.size();i++)
+        m_Workers[i]->th = std::make_unique<std::thread>(&scheduler::workerThread, this, i);
+
+    m_Trace.print(ID, "Started %u chains on %u workers\n", static_cast<uint32_t>(m_Tasks.size()),
+                    static_cast<uint32_t>(m_Workers.size()));
+    return true;
+}
+
+void scheduler::stop()
+{
+    if (!m_Active)
+        return;
+
+    m_Active = false;
+
+    for (auto &w : m_Workers)
+    {
+        if (w->th.get())
+            w->th->join();
+
+        w->th.reset();
+    }
+
+    m_Trace.print(ID, "Stopped\n");
+}
+
+void scheduler::stats(std::vector<chain_stats> &s) const
+{
+    for (auto &t : m_Tasks)
+    {
+        chain_stats cs;
+
+        cs.name = t->ch->getName();
+        cs.iterations = t->iterations.load(std::memory_order_relaxed);
+        cs.steals = t->steals.load(std::memory_order_relaxed);
+        t->wait.get(cs.wait);
+        t->run.get(cs.run);
+
+        s.push_back(cs);
+    }
+}
+
+void scheduler::resetStats()
+{
+    for (auto &t : m_Tasks)
+    {
+        t->iterations = 0;
+        t->steals = 0;
+        t->wait.reset();
+        t->run.reset();
+    }
+}
+
+void scheduler::push(worker &w, const uint32_t t)
+{
+    std::lock_guard<std::mutex> lck(w.mtx);
+
+    assert(w.count < w.tasks.size());
+
+    w.tasks[(w.head + w.count) % w.tasks.size()] = t;
+    w.count++;
+}
+
+bool scheduler::popFront(worker &w, uint32_t &t)
+{
+    std::lock_guard<std::mutex> lck(w.mtx);
+
+    if (!w.count)
+        return false;
+
+    t = w.tasks[w.head];
+    w.head = (w.head + 1) % w.tasks.size();
+    w.count--;
+
+    return true;
+}
+
+bool scheduler::peekFront(worker &w, util::profiler<true>::mark_t &queued)
+{
+    std::lock_guard<std::mutex> lck(w.mtx);
+
+    if (!w.count)
+        return false;
+
+    queued = m_Tasks[w.tasks[w.head]]->queued;
+    return true;
+}
+
+bool scheduler::steal(const size_t self, uint32_t &t, const util::profiler<true>::mark_t *before)
+{
+    // Find the victim whose front chain was queued first. Start with the next worker so thieves
+    // spread out over victims whose chains were queued at the same time.
+    size_t victim = m_Workers.size();
+    util::profiler<true>::mark_t oldest;
+
+    for (size_t i=1;i < m_Workers.size();i++)
+    {
+        const size_t v = (self + i) % m_Workers.size();
+        worker &w = *m_Workers[v];
+
+        std::lock_guard<std::mutex> lck(w.mtx);
+
+        if (!w.count)
+            continue;
+
+        const auto queued = m_Tasks[w.tasks[w.head]]->queued;
+
+        if ((victim == m_Workers.size()) || (queued < oldest))
+        {
+            victim = v;
+            oldest = queued;
+        }
+    }
+
+    if ((victim == m_Workers.size()) || (before && !(oldest < *before)))
+        return false;
+
+    // The victim may have taken its front chain in the meantime; its next one is as good.
+    return popFront(*m_Workers[victim], t);
+}
+
+void scheduler::workerThread(const size_t self)
+{
+    worker &w = *m_Workers[self];
+
+    // The number of chains in a row which weren't ready
+    size_t misses = 0;
+
+    // The chain iterated last, if it was put back
+    uint32_t last = UINT32_MAX;
+
+    while(m_Active)
+    {
+        uint32_t id;
+        util::profiler<true>::mark_t front;
+        bool heldUp = false;
+
+        // A chain held up on another worker, e.g., behind a slow chain, which has waited longer
+        // than the next chain here by more than the yield time is taken first.
+        if ((m_Workers.size() > 1) && peekFront(w, front))
+        {
+            front -= std::chrono::microseconds(m_YieldTime);
+            heldUp = steal(self, id, &front);
+        }
+
+        if (heldUp)
+        {
+            m_Tasks[id]->steals.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (!popFront(w, id))
+        {
+            if (!steal(self, id))
+            {
+                timer::sleepUs(m_YieldTime);
+                continue;
+            }
+
+            m_Tasks[id]->steals.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (id == last)
+        {
+            // Nothing else was waiting here. Rather than run the same chain again while chains
+            // queued on a busier worker wait, take one of those.
+            uint32_t other;
+
+            if (steal(self, other))
+            {
+                push(w, id);
+                id = other;
+                m_Tasks[id]->steals.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        task &t = *m_Tasks[id];
+
+        if (t.ready && !t.ready())
+        {
+            // The wait is measured from the last time the chain was found not ready.
+            t.queued = timer::StartTimer();
+            push(w, id);
+            last = UINT32_MAX;
+
+            // Every chain was probably checked so give the sources time to catch up.
+            if (++misses >= m_Tasks.size())
+            {
+                misses = 0;
+                timer::sleepUs(m_YieldTime);
+            }
+
+            continue;
+        }
+
+        misses = 0;
+        t.wait.stop(t.queued, 0, 0);
+
+        auto mark = t.run.start();
+        t.ch->iterate();
+        t.run.stop(mark, 0, 0);
+
+        t.iterations.store(t.iterations.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        t.queued = timer::StartTimer();
+        push(w, id);
+        last = id;
+    }
+}
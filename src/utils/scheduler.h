@@ -0,0 +1,185 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+
+#include "chain.h"
+#include "trace.h"
+#include "timer.h"
+#include "profiler.h"
+#include "ring-buffer.h"
+
+namespace util {
+
+/*! \brief Run Many Chains on a Pool of Worker Threads
+ *
+ * Running each chain with *chain::run()* costs one thread per chain which doesn't scale to, say, a
+ * few dozen channelized demodulators on an 8 core machine. A *scheduler* owns a fixed number of
+ * worker threads and calls *chain::iterate()* for each of its chains whenever the chain is ready,
+ * so any number of chains share the same cores.
+ *
+ * Each worker has its own queue of chains. A worker takes the chain at the front of its queue,
+ * iterates it once and puts it at the back again, so the chains of a worker take turns and none of
+ * them can starve the others. A worker whose queue runs dry, or which would otherwise run the same
+ * chain again, *steals* the chain which has waited longest at the front of another worker's queue.
+ * So does a worker whose own next chain has waited less than that one by more than the yield time,
+ * e.g., because the other worker is held up by a slow chain. This moves load from busy workers to
+ * idle ones, and keeps chains from always waiting on the same worker while others never wait,
+ * without a central queue all the workers contend on. A chain is only ever in one queue or on one
+ * worker so it's never iterated by two threads at once.
+ *
+ * A chain is ready when its *ready* predicate, if one was given to *add()*, returns **true**, e.g.,
+ * when the ring buffer feeding its source holds a full block (see *whenAvailable()*). A chain which
+ * isn't ready goes to the back of the queue without being iterated. Chains without a predicate are
+ * always ready so their sources should not block for long or they'll hold up a worker.
+ *
+ * The time a ready chain waits in a queue (the time since it was last put back) and the time each
+ * iteration takes are collected per chain and read with *stats()*.
+ *
+ * \note Chains are passed in by reference and must have been set up. The caller is responsible for
+ * making sure their lifetime is maintained while the scheduler is running. Do not iterate or
+ * *run()* the chains elsewhere while they are scheduled.
+ */
+
+class scheduler
+{
+public:
+
+    //! Results of a chain returned by *stats()*.
+    struct chain_stats
+    {
+        //! The name of the chain.
+        const char *name;
+
+        //! The number of iterations.
+        uint64_t iterations;
+
+        //! The number of times the chain was stolen by another worker.
+        uint64_t steals;
+
+        //! The time the chain waited in a queue before it was iterated. Only the call counts and
+        //! times are used.
+        util::profile_stats wait;
+
+        //! The time the iterations took. Only the call counts and times are used.
+        util::profile_stats run;
+    };
+
+    //! Create an instance.
+    //! @param [in] workers    The number of worker threads.
+    //! @param [in] yieldTime  Time in microseconds a worker yields when none of its chains are ready
+    //!                        and there's nothing to steal.
+    scheduler(const uint32_t workers, const uint32_t yieldTime = 100);
+
+    ~scheduler()
+    {
+        stop();
+    }
+
+    scheduler() = delete;
+
+    scheduler(const scheduler &) = delete;
+    scheduler& operator=(const scheduler &) = delete;
+
+    scheduler(scheduler &&) = delete;
+    scheduler& operator=(scheduler &&) = delete;
+
+    //! Add a chain to be scheduled. This can only be done while the scheduler is stopped.
+    //! @param [in] c      A reference to the chain. It must be set up.
+    //! @param [in] ready  A predicate which returns **true** when the chain can be iterated without
+    //!                    blocking, or empty if it always can. It's called from the worker threads.
+    //! @return The index of the chain in the results of *stats()* or -1 if the scheduler is running.
+    int add(chain &c, std::function<bool()> ready = nullptr);
+
+    //! Get a *ready* predicate for *add()* which returns **true** when a ring buffer holds at least
+    //! a given number of elements, e.g., the block size of a source which reads from it.
+    //! @param [in] rb      The ring buffer.
+    //! @param [in] amount  The number of elements.
+    template<typename T>
+    static std::function<bool()> whenAvailable(util::ring_buffer<T> &rb, const size_t amount)
+    {
+        return [&rb, amount]() { return rb.amount() >= amount; };
+    }
+
+    //! Start the worker threads. The chains are dealt out to the workers in the order they were added.
+    //! @return **true** if the scheduler started, **false** if there are no chains or it's already running.
+    bool start();
+
+    //! Stop the worker threads and wait for them to exit. Calling this when the scheduler isn't
+    //! running has no effect.
+    //! \warning Sources or sinks which block must be able to return for the workers to exit.
+    void stop();
+
+    //! Check if the scheduler is running.
+    bool isRunning() const { return m_Active; }
+
+    //! Get the results of each chain in the order they were added. This may be called from any
+    //! thread while the scheduler is running.
+    //! @param [out] s  An empty vector to which the results are written.
+    void stats(std::vector<chain_stats> &s) const;
+
+    //! Clear the results of every chain. Only call this while the scheduler is stopped.
+    void resetStats();
+
+private:
+
+    //! \cond
+
+    struct task
+    {
+        task(chain *c, std::function<bool()> &&r) : ch { c }, ready { std::move(r) }, iterations { 0 }, steals { 0 } { }
+
+        chain *ch;
+        std::function<bool()> ready;
+
+        // Set when the chain is put in a queue
+        util::profiler<true>::mark_t queued;
+
+        util::profiler<true> wait;
+        util::profiler<true> run;
+        std::atomic<uint64_t> iterations;
+        std::atomic<uint64_t> steals;
+    };
+
+    // A bounded queue of task indices. Chains are taken from the front, by the owner or thieves,
+    // and put back at the back. Every task is in at most one queue so the size of each is the
+    // number of tasks and nothing is allocated while running.
+    struct worker
+    {
+        worker() : head { 0 }, count { 0 } { }
+
+        std::mutex mtx;
+        std::vector<uint32_t> tasks;
+        size_t head;
+        size_t count;
+        std::unique_ptr<std::thread> th;
+    };
+
+    std::vector<std::unique_ptr<task>> m_Tasks;
+    std::vector<std::unique_ptr<worker>> m_Workers;
+
+    std::atomic<bool> m_Active;
+    uint32_t m_YieldTime;
+
+    void push(worker &w, const uint32_t t);
+    bool popFront(worker &w, uint32_t &t);
+    bool peekFront(worker &w, util::profiler<true>::mark_t &queued);
+    bool steal(const size_t self, uint32_t &t, const util::profiler<true>::mark_t *before = nullptr);
+
+    void workerThread(const size_t self);
+
+    static constexpr char const *ID = "SCHEDULER";
+    util::trace<> m_Trace;
+
+    //! \endcond
+};
+
+}
@@ -0,0 +1,178 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "aligned-ptr.h"
+#include "aligned-span.h"
+#include "aligned-pool.h"
+
+namespace util {
+
+/*! \brief Reference-counted Immutable Block of Samples
+ *
+ * A *shared_block* lets several consumers hold the same block of samples without each getting its own
+ * copy, e.g., a *port*, a ZMQ publisher (see *zmq::sample_msg::send()*) and a file sink. Copying a
+ * *shared_block* only adds a reference. The samples can't be changed once shared, and the buffer goes
+ * back to the *aligned_pool* of the thread dropping the last reference.
+ *
+ * Create one by moving an *aligned_ptr* in, which takes over its buffer, or by copying samples from a
+ * span, e.g., a block a chain will reuse on its next iteration. The counting is atomic so references
+ * may be dropped on any thread.
+ *
+ * \note A block made from a static *aligned_ptr* refers to the caller's buffer, which must outlive
+ * every reference.
+ */
+
+template<typename T>
+class shared_block
+{
+    static_assert(is_std_complex_v<T> || (std::is_arithmetic<T>::value == std::true_type()));
+
+public:
+
+    //! Create an empty block.
+    shared_block() : m_Node { nullptr } { }
+
+    //! Create a block by taking over the buffer of *samples*; nothing is copied.
+    //! @param [in] samples  The samples. It's left in the cleared state.
+    explicit shared_block(aligned_ptr<T> &&samples) : m_Node { createNode() }
+    {
+        m_Node->samples = std::move(samples);
+    }
+
+    //! Create a block from a copy of *samples*.
+    //! @param [in] samples  The samples to copy.
+    explicit shared_block(aligned_span<const T> samples) : m_Node { createNode() }
+    {
+        init_aligned_ptr<T>(m_Node->samples, samples.size(), samples.data());
+    }
+
+    ~shared_block() { reset(); }
+
+    shared_block(const shared_block &other) : m_Node { other.m_Node }
+    {
+        if (m_Node)
+            m_Node->refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    shared_block& operator=(const shared_block &other)
+    {
+        if (m_Node != other.m_Node)
+        {
+            reset();
+            m_Node = other.m_Node;
+
+            if (m_Node)
+                m_Node->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        return *this;
+    }
+
+    shared_block(shared_block &&other) : m_Node { std::exchange(other.m_Node, nullptr) } { }
+
+    shared_block& operator=(shared_block &&other)
+    {
+        if (this != &other)
+        {
+            reset();
+            m_Node = std::exchange(other.m_Node, nullptr);
+        }
+
+        return *this;
+    }
+
+    //! Drop this reference. The block is empty afterwards.
+    void reset()
+    {
+        unref(std::exchange(m_Node, nullptr));
+    }
+
+    //! Move the samples out into *samples* and drop this reference. If this is the last reference the
+    //! buffer itself is handed over, otherwise the samples are copied.
+    //! @param [out] samples  Receives the samples.
+    void take(aligned_ptr<T> &samples)
+    {
+        if (!m_Node)
+        {
+            init_aligned_ptr_on_resize<T>(samples, 0);
+            return;
+        }
+
+        if (m_Node->refs.load(std::memory_order_acquire) == 1)
+            samples = std::move(m_Node->samples);
+        else
+        {
+            init_aligned_ptr_on_resize<T>(samples, size());
+
+            if (size())
+                std::memcpy(&samples[0], data(), size() * sizeof(T));
+        }
+
+        reset();
+    }
+
+    const T* data() const { return m_Node ? m_Node->samples.data() : nullptr; }
+    size_t size() const { return m_Node ? m_Node->samples.size() : 0; }
+    bool empty() const { return !size(); }
+
+    const T& operator[](const size_t i) const { return m_Node->samples[i]; }
+
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+
+    //! Get the number of references to the block, including this one.
+    uint32_t useCount() const { return m_Node ? m_Node->refs.load(std::memory_order_relaxed) : 0; }
+
+    //! Add a reference on behalf of a C API which frees buffers through a callback, e.g., ZMQ. Pass
+    //! the handle to *unref()* from the callback.
+    //! @return The handle, or **nullptr** for an empty block.
+    void* ref() const
+    {
+        if (m_Node)
+            m_Node->refs.fetch_add(1, std::memory_order_relaxed);
+
+        return m_Node;
+    }
+
+    //! Drop a reference added by *ref()*.
+    //! @param [in] handle  The handle returned by *ref()*.
+    static void unref(void *handle)
+    {
+        node *n = static_cast<node*>(handle);
+
+        if (n && (n->refs.fetch_sub(1, std::memory_order_acq_rel) == 1))
+        {
+            n->~node();
+            aligned_pool::release(n, sizeof(node));
+        }
+    }
+
+private:
+
+    //! \cond
+    struct node
+    {
+        node() : refs { 1 } { }
+
+        std::atomic<uint32_t> refs;
+        aligned_ptr<T> samples;
+    };
+
+    // The nodes come from the pool as well so sharing a block doesn't reach the heap either.
+    static node* createNode()
+    {
+        return new (aligned_pool::alloc(sizeof(node))) node();
+    }
+    //! \endcond
+
+    node *m_Node;
+};
+
+}
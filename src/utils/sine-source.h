@@ -8,6 +8,7 @@
 #include <rm-math.h>
 
 #include "aligned-ptr.h"
+#include "workspace.h"
 
 namespace util {
 
@@ -71,27 +72,54 @@ public:
         base::m_Gain = gain;
     }
 
+    //! Get the scratch space, in bytes, *get()* needs for a block of *size* samples.
+    static size_t scratchSize(const size_t size)
+    {
+        return 2 * workspace::bytes<T>(size);
+    }
+
+    //! Size the scratch space used when no workspace is given up front.
+    //! @param [in] size  The largest block *get()* will be called with.
+    void reserve(const size_t size)
+    {
+        m_Scratch.reserve(scratchSize(size));
+    }
+
     //! Calculate and return a set of samples
     //! @param [inout] outBlock   An initialzed *aligned_ptr* with the required size which
     //!                           will be returned with the samples.
     void get(aligned_ptr<T> &outBlock)
     {
-        auto v1 = make_aligned_ptr<T>(outBlock.size());
-        auto v2 = make_aligned_ptr<T>(outBlock.size());
+        get(outBlock, m_Scratch.get(scratchSize(outBlock.size())));
+    }
+
+    //! Calculate and return a set of samples using the caller's scratch space.
+    //! @param [inout] outBlock   An initialzed *aligned_ptr* with the required size which
+    //!                           will be returned with the samples.
+    //! @param [in]    ws         The workspace; it must hold *scratchSize()* bytes for *outBlock*.
+    void get(aligned_ptr<T> &outBlock, workspace &ws)
+    {
+        auto phases = ws.get<T>(outBlock.size());
+        auto v = ws.get<T>(outBlock.size());
 
         // Set up a vector of phases
         for (size_t i=0;i < outBlock.size();i++)
         {
-            v1[i] = base::m_Phase;
+            phases[i] = base::m_Phase;
 
             base::m_Phase += base::m_Freq;
             if (base::m_Phase > (2 * M_PI))
                 base::m_Phase -= 2 * M_PI;
         }
 
-        rm_math::blk_cos(&v2[0], v1.data(), v1.size());
-        rm_math::vect_scaler_mult(&outBlock[0], v2.data(), base::m_Gain, outBlock.size());
+        rm_math::blk_cos(v.data(), phases.data(), phases.size());
+        rm_math::vect_scaler_mult(&outBlock[0], v.data(), base::m_Gain, outBlock.size());
     }
+
+private:
+
+    // Used by callers which don't pass a workspace
+    scratch_buffer m_Scratch;
 };
 
 /*! \brief Sinusoidal Signal Generator for Complex Types
@@ -114,19 +142,42 @@ public:
         m_Gain = gain;
     }
 
+    //! Get the scratch space, in bytes, *get()* needs for a block of *size* samples.
+    static size_t scratchSize(const size_t size)
+    {
+        return 3 * workspace::bytes<float>(size);
+    }
+
+    //! Size the scratch space used when no workspace is given up front.
+    //! @param [in] size  The largest block *get()* will be called with.
+    void reserve(const size_t size)
+    {
+        m_Scratch.reserve(scratchSize(size));
+    }
+
     //! Calculate and return a set of samples
     //! @param [inout] outBlock   An initialzed *aligned_ptr* with the required size which
     //!                           will be returned with the samples.
     void get(aligned_ptr<rm_math::complex_f> &outBlock)
     {
-        auto v1 = make_aligned_ptr<float>(outBlock.size());
-        auto v2 = make_aligned_ptr<float>(outBlock.size());
-        auto phase = make_aligned_ptr<float>(outBlock.size());
+        get(outBlock, m_Scratch.get(scratchSize(outBlock.size())));
+    }
+
+    //! Calculate and return a set of samples using the caller's scratch space.
+    //! @param [inout] outBlock   An initialzed *aligned_ptr* with the required size which
+    //!                           will be returned with the samples.
+    //! @param [in]    ws         The workspace; it must hold *scratchSize()* bytes for *outBlock*.
+    void get(aligned_ptr<rm_math::complex_f> &outBlock, workspace &ws)
+    {
+        const size_t n = outBlock.size();
+        auto phases = ws.get<float>(n);
+        auto v1 = ws.get<float>(n);
+        auto v2 = ws.get<float>(n);
 
         // Set up a vector of phases
-        for (size_t i=0;i < outBlock.size();i++)
+        for (size_t i=0;i < n;i++)
         {
-            phase[i] = m_Phase;
+            phases[i] = m_Phase;
 
             m_Phase += m_Freq;
             if (m_Phase > (2 * M_PI))
@@ -134,19 +185,24 @@ public:
         }
 
         // real part (I)
-        rm_math::blk_cos(&v1[0], phase.data(), v1.size());
-        rm_math::vect_scaler_mult(&v2[0], v1.data(), m_Gain, v2.size());
+        rm_math::blk_cos(v1.data(), phases.data(), n);
+        rm_math::vect_scaler_mult(v2.data(), v1.data(), m_Gain, n);
 
-        for (size_t i=0;i < outBlock.size();i++)
+        for (size_t i=0;i < n;i++)
             outBlock[i].real(v2[i]);
 
         // imaginary part (Q)
-        rm_math::blk_sin(&v1[0], phase.data(), v1.size());
-        rm_math::vect_scaler_mult(&v2[0], v1.data(), m_Gain, v2.size());
+        rm_math::blk_sin(v1.data(), phases.data(), n);
+        rm_math::vect_scaler_mult(v2.data(), v1.data(), m_Gain, n);
 
-        for (size_t i=0;i < outBlock.size();i++)
+        for (size_t i=0;i < n;i++)
             outBlock[i].imag(v1[i]);
     }
+
+private:
+
+    // Used by callers which don't pass a workspace
+    scratch_buffer m_Scratch;
 };
 
 }
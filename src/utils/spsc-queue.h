@@ -0,0 +1,111 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cassert>
+#include <cstdint>
+
+namespace util {
+
+//! The cache line size used to pad data shared between threads.
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+/*! \brief Bounded SPSC Slot Queue
+ *
+ * A lock-free, fixed size queue for handing objects from one thread (the *producer*) to
+ * another (the *consumer*). Rather than copying objects in and out of the queue, the caller
+ * works directly on the slots: the producer fills the slot returned by *back()* and publishes
+ * it with *push()*, the consumer works on the slot returned by *front()* and releases it with
+ * *pop()*.
+ *
+ * The slots are created once and never destroyed while the queue exists, so whatever the
+ * consumer leaves behind in a slot (e.g., a buffer swapped out of the slot) is handed back to
+ * the producer the next time that slot comes around. This allows buffers to circulate between
+ * two threads without any allocations.
+ *
+ * \note The size must be mod-2. Neither side blocks; a *nullptr* is returned when the queue
+ * is full (*back()*) or empty (*front()*) and it is up to the caller how to wait.
+ */
+
+template<typename T>
+class spsc_queue
+{
+public:
+
+    //! Create an instance.
+    //! @param [in] size  The number of slots in the queue. This must be mod-2.
+    spsc_queue(const uint32_t size) : m_Mask { size - 1 }, m_Head { 0 }, m_Tail { 0 }
+    {
+        assert((size > 0) && !(size & (size - 1)));
+        m_Slots = std::make_unique<T[]>(size);
+    }
+
+    spsc_queue() = delete;
+
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    spsc_queue(spsc_queue&&) = delete;
+    spsc_queue& operator=(spsc_queue&&) = delete;
+
+    //! Producer side. Get the next free slot.
+    //! @return A pointer to the slot or *nullptr* if the queue is full.
+    T* back()
+    {
+        auto head = m_Head.load(std::memory_order_relaxed);
+
+        if ((head - m_Tail.load(std::memory_order_acquire)) > m_Mask)
+            return nullptr;
+
+        return &m_Slots[head & m_Mask];
+    }
+
+    //! Producer side. Publish the slot returned by the last call to *back()*.
+    void push()
+    {
+        m_Head.store(m_Head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //! Consumer side. Get the oldest published slot.
+    //! @return A pointer to the slot or *nullptr* if the queue is empty.
+    T* front()
+    {
+        auto tail = m_Tail.load(std::memory_order_relaxed);
+
+        if (tail == m_Head.load(std::memory_order_acquire))
+            return nullptr;
+
+        return &m_Slots[tail & m_Mask];
+    }
+
+    //! Consumer side. Release the slot returned by the last call to *front()* back to the producer.
+    void pop()
+    {
+        m_Tail.store(m_Tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //! Get the number of published slots. This is only a snapshot if called while
+    //! the queue is active.
+    uint32_t amount() const
+    {
+        return m_Head.load(std::memory_order_acquire) - m_Tail.load(std::memory_order_acquire);
+    }
+
+private:
+
+    std::unique_ptr<T[]> m_Slots;
+    uint32_t m_Mask;
+
+    // Keep the producer and consumer indices on separate cache lines.
+    uint8_t m_Pad0[CACHE_LINE_SIZE];
+    std::atomic<uint32_t> m_Head;
+    uint8_t m_Pad1[CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+    std::atomic<uint32_t> m_Tail;
+    uint8_t m_Pad2[CACHE_LINE_SIZE - sizeof(std::atomic<uint32_t>)];
+};
+
+}
@@ -0,0 +1,245 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <tuple>
+#include <algorithm>
+#include <array>
+#include <type_traits>
+
+#include "block.h"
+#include "trace.h"
+#include "aligned-ptr.h"
+#include "workspace.h"
+
+namespace util {
+
+//! \cond
+
+template<typename Blk>
+using block_in_t = typename dsp::block_io<typename Blk::func_type>::in_type;
+
+template<typename Blk>
+using block_out_t = typename dsp::block_io<typename Blk::func_type>::out_type;
+
+// Check that the output type of each block matches the input type of the next block.
+template<typename... Blks>
+struct links_match : std::true_type {};
+
+template<typename A, typename B, typename... Rest>
+struct links_match<A, B, Rest...> :
+    std::integral_constant<bool, std::is_same<block_out_t<A>, block_in_t<B>>::value && links_match<B, Rest...>::value> {};
+
+//! \endcond
+
+/*! \brief Create a Compile-time Chain of DSP Blocks
+ *
+ * This is the compile-time equivalent of *util::chain*. The blocks are given as template parameters
+ * in chain order, source first and sink last, e.g.:
+ *
+ *     util::static_chain<dsp::endpoints::signal_source_ff, dsp::firfilter_ff, dsp::endpoints::callback_ff>
+ *         theChain { source, filter, sink };
+ *
+ * The data types of adjacent links are checked at compile time and each link is called directly
+ * through *dsp::processor* rather than through a *std::function* and a runtime switch on the
+ * link type. This lets the compiler inline across links which makes a difference for small block,
+ * low latency chains such as audio chains where the per-link dispatch overhead is a measurable part
+ * of each iteration. The buffers between links are typed per link so no type switching happens
+ * during an iteration either.
+ *
+ * The trade off is that the shape of the chain is fixed at compile time. The sampling rate propagation,
+ * endpoint rules and in-place handling are the same as *util::chain*.
+ *
+ * \note Blocks are passed in by reference. The caller is responsible for making sure the lifetime of
+ * the blocks is maintained while the chain is active.
+ */
+
+template<typename... Blks>
+class static_chain
+{
+    static_assert(sizeof...(Blks) > 1, "A chain needs at least a source and a sink");
+    static_assert(links_match<Blks...>::value, "Invalid link! I/O doesn't match");
+
+public:
+
+    //! The number of links in the chain.
+    static constexpr size_t LINKS = sizeof...(Blks);
+
+    //! Create an instance.
+    //! @param [in] blks  The blocks of the chain in the order of the template parameters.
+    static_chain(Blks&... blks) : m_Blocks { blks... }, m_MaxScratch { 0 }, m_IsChecked { false }
+    {
+        m_Modes.fill(dsp::BIDIR_NONE);
+    }
+
+    static_chain() = delete;
+
+    static_chain(const static_chain &) = delete;
+    static_chain& operator=(const static_chain &) = delete;
+
+    static_chain(static_chain &&) = delete;
+    static_chain& operator=(static_chain &&) = delete;
+
+    //! Validate the chain endpoints and complete the setup. The link types were already checked
+    //! at compile time. This must be called before iteration.
+    //! @return **true** if the chain is valid, **false** otherwise.
+    bool setup()
+    {
+        auto first = std::get<0>(m_Blocks).getType();
+        auto last = std::get<LINKS - 1>(m_Blocks).getType();
+
+        m_Trace.print(ID, "Is the first link a source?\n");
+
+        if ((first != dsp::TYPE_SOURCE) && (first != dsp::TYPE_BIDIR))
+        {
+            m_Trace.print(ID, "NO -- FAIL\n");
+            return false;
+        }
+
+        m_Trace.print(ID, "YES. Is the last link a sink?\n");
+
+        if ((last != dsp::TYPE_SINK) && (last != dsp::TYPE_BIDIR))
+        {
+            m_Trace.print(ID, "NO -- FAIL\n");
+            return false;
+        }
+
+        if (first == dsp::TYPE_BIDIR)
+            m_Modes[0] = dsp::BIDIR_SOURCE;
+
+        if (last == dsp::TYPE_BIDIR)
+            m_Modes[LINKS - 1] = dsp::BIDIR_SINK;
+
+        // Size the buffers and the scratch now so iteration doesn't have to. See util::chain.
+        m_MaxScratch = 0;
+        plan<0>(0);
+
+        if (m_MaxScratch && (m_ScratchMem.size() < m_MaxScratch))
+        {
+            init_aligned_ptr(m_ScratchMem, m_MaxScratch);
+            m_Scratch = workspace(aligned_span<uint8_t> { m_ScratchMem });
+        }
+
+        m_IsChecked = true;
+        return true;
+    }
+
+    //! Iterate through the chain once. See *util::chain::iterate()*.
+    void iterate()
+    {
+        assert(m_IsChecked);
+
+        dsp::rate_t rate = 0;
+        run<0>(rate, m_SourceIn);
+    }
+
+private:
+
+    using first_t = typename std::tuple_element<0, std::tuple<Blks...>>::type;
+
+    // The blocks and the output buffer of each link
+    std::tuple<Blks&...> m_Blocks;
+    std::tuple<aligned_ptr<block_out_t<Blks>>...> m_Buffers;
+
+    // The (unused) input of the source
+    aligned_ptr<block_in_t<first_t>> m_SourceIn;
+
+    // The scratch memory of the links, shared by all of them since only one runs at a time
+    aligned_ptr<uint8_t> m_ScratchMem;
+    workspace m_Scratch;
+    size_t m_MaxScratch;
+
+    std::array<dsp::bidir_mode, LINKS> m_Modes;
+    bool m_IsChecked;
+
+    static constexpr char const *ID = "STATIC_CHAIN";
+    util::trace<> m_Trace;
+
+    template<size_t I>
+    typename std::enable_if<(I < LINKS)>::type plan(size_t maxIn)
+    {
+        auto &blk = std::get<I>(m_Blocks);
+        auto &out = std::get<I>(m_Buffers);
+
+        blk.setMaxInputSize(maxIn);
+        blk.setWorkspace(&m_Scratch);
+        m_MaxScratch = std::max(m_MaxScratch, blk.getScratchSize(maxIn));
+
+        if ((blk.getType() == dsp::TYPE_SOURCE) || (m_Modes[I] == dsp::BIDIR_SOURCE))
+            maxIn = blk.getMaxSourceSize();
+        else if ((blk.getType() == dsp::TYPE_SINK) || (m_Modes[I] == dsp::BIDIR_SINK))
+            maxIn = 0;
+        else
+            maxIn = blk.getMaxOutputSize(maxIn);
+
+        // In-place links use their input buffer
+        if (!blk.isInPlace() && (out.capacity() < maxIn))
+        {
+            init_aligned_ptr(out, maxIn);
+            init_aligned_ptr_on_resize(out, 0);
+        }
+
+        plan<I + 1>(maxIn);
+    }
+
+    template<size_t I>
+    typename std::enable_if<(I == LINKS)>::type plan(size_t maxIn)
+    {
+    }
+
+    template<size_t I, typename U>
+    typename std::enable_if<(I < LINKS)>::type run(dsp::rate_t &rate, aligned_ptr<U> &in)
+    {
+        auto &blk = std::get<I>(m_Blocks);
+
+        // Same as chain::handleLink()
+        blk.setSamplingRate(rate);
+        blk.setBidirMode(m_Modes[I]);
+
+        step<I>(blk, rate, in, std::get<I>(m_Buffers));
+    }
+
+    template<size_t I, typename U>
+    typename std::enable_if<(I == LINKS)>::type run(dsp::rate_t &rate, aligned_ptr<U> &in)
+    {
+    }
+
+    // Call the block and move on to the next link. An in-place block works on its input buffer
+    // which is then passed on instead of the link's own buffer.
+    template<size_t I, typename Blk, typename T>
+    void step(Blk &blk, dsp::rate_t &rate, aligned_ptr<T> &in, aligned_ptr<T> &out)
+    {
+        if (blk.isInPlace())
+        {
+            dsp::processor<Blk>::call(blk, in, in);
+            next<I>(blk, rate, in);
+        }
+        else
+        {
+            dsp::processor<Blk>::call(blk, in, out);
+            next<I>(blk, rate, out);
+        }
+    }
+
+    template<size_t I, typename Blk, typename U, typename V>
+    void step(Blk &blk, dsp::rate_t &rate, aligned_ptr<U> &in, aligned_ptr<V> &out)
+    {
+        dsp::processor<Blk>::call(blk, in, out);
+        next<I>(blk, rate, out);
+    }
+
+    template<size_t I, typename Blk, typename V>
+    void next(Blk &blk, dsp::rate_t &rate, aligned_ptr<V> &out)
+    {
+        auto type = blk.getType();
+
+        if ((type == dsp::TYPE_SOURCE) || (type == dsp::TYPE_RESAMPLER) || (type == dsp::TYPE_BIDIR))
+            rate = blk.getSamplingRate();
+
+        run<I + 1>(rate, out);
+    }
+};
+
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+namespace util {
+
+/*! \brief Cooperative Stop Request
+ *
+ * A minimal version of the C++20 *std::stop_source* / *std::stop_token* pair. A *stop_source*
+ * hands out tokens which share its state; any thread may call *request_stop()* on the source and
+ * whoever holds a token polls *stop_requested()* and winds down at a convenient point.
+ *
+ * A default constructed *stop_token* has no source and never requests a stop.
+ */
+
+class stop_token
+{
+public:
+
+    //! Create a token which never requests a stop.
+    stop_token() { }
+
+    //! Check if a stop was requested.
+    bool stop_requested() const
+    {
+        return m_State && m_State->load(std::memory_order_acquire);
+    }
+
+    //! Check if the token is associated with a source, i.e., a stop can be requested at all.
+    bool stop_possible() const
+    {
+        return static_cast<bool>(m_State);
+    }
+
+private:
+
+    friend class stop_source;
+
+    stop_token(const std::shared_ptr<std::atomic<bool>> &state) : m_State { state } { }
+
+    std::shared_ptr<std::atomic<bool>> m_State;
+};
+
+class stop_source
+{
+public:
+
+    //! Create a source with a new, unrequested, stop state.
+    stop_source() : m_State { std::make_shared<std::atomic<bool>>(false) } { }
+
+    //! Get a token which shares the stop state of this source.
+    stop_token get_token() const
+    {
+        return stop_token { m_State };
+    }
+
+    //! Request a stop. This may be called from any thread.
+    //! @return **true** if this call made the request, **false** if it was already requested.
+    bool request_stop()
+    {
+        return !m_State->exchange(true, std::memory_order_acq_rel);
+    }
+
+    //! Check if a stop was requested.
+    bool stop_requested() const
+    {
+        return m_State->load(std::memory_order_acquire);
+    }
+
+private:
+
+    std::shared_ptr<std::atomic<bool>> m_State;
+};
+
+}
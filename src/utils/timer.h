@@ -41,6 +41,29 @@ struct cpp_timer
         return std::chrono::duration_cast<std::chrono::microseconds>(now - tmr).count();
     }
 
+    // Return the elapsed time in nanoseconds between these call and a previous call to
+    // StartTimer(). Some platform might not support nanosecond resolution in which
+    // case the resolution of the platform clock is used.
+    static uint64_t EndTimerNs(timer_t &tmr)
+    {
+        auto now = std::chrono::steady_clock::now();
+
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now - tmr).count();
+    }
+
+    // Return the time *ns* nanoseconds before *tmr*, e.g., to date a sample block back to when
+    // it was captured.
+    static timer_t BeforeNs(const timer_t &tmr, uint64_t ns)
+    {
+        return tmr - std::chrono::nanoseconds(ns);
+    }
+
+    // Return *tmr* in nanoseconds since the epoch of the clock.
+    static uint64_t Ns(const timer_t &tmr)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(tmr.time_since_epoch()).count();
+    }
+
     static void sleep(uint32_t ms)
     {
         std::this_thread::sleep_for(std::chrono::milliseconds(ms));
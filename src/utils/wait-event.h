@@ -0,0 +1,120 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <climits>
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#else
+#include <mutex>
+#include <condition_variable>
+#endif
+
+namespace util {
+
+/*! \brief Blocking Wait for a Condition Published by Another Thread
+ *
+ * Lets a thread sleep until another thread changes some lock-free state, e.g., the indices of a
+ * *ring_buffer*, without polling. The waiter checks its condition, announces itself with
+ * *prepareWait()*, checks again and only then sleeps in *wait()*:
+ *
+ * \code
+ *  while(!ready())
+ *  {
+ *      auto key = ev.prepareWait();
+ *
+ *      if (ready())
+ *      {
+ *          ev.cancelWait();
+ *          break;
+ *      }
+ *
+ *      ev.wait(key);
+ *  }
+ * \endcode
+ *
+ * The other thread publishes the change and calls *notify()*, which costs a fence and a load
+ * unless someone is waiting. A notification between *prepareWait()* and *wait()* isn't lost.
+ * Linux uses a futex; other platforms a condition variable.
+ */
+
+class wait_event
+{
+public:
+
+    wait_event() : m_Seq { 0 }, m_Waiters { 0 } { }
+
+    wait_event(const wait_event&) = delete;
+    wait_event& operator=(const wait_event&) = delete;
+
+    //! Announce a wait. Check the condition again after this before calling *wait()*.
+    //! @return The key to pass to *wait()*.
+    uint32_t prepareWait()
+    {
+        m_Waiters.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        return m_Seq.load(std::memory_order_acquire);
+    }
+
+    //! Withdraw a wait announced by *prepareWait()* when the condition was met after all.
+    void cancelWait()
+    {
+        m_Waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    //! Sleep until *notify()* is called after *prepareWait()* returned *key*. It may return early, so
+    //! check the condition again.
+    void wait(const uint32_t key)
+    {
+#ifdef __linux__
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_Seq), FUTEX_WAIT_PRIVATE, key, nullptr, nullptr, 0);
+#else
+        std::unique_lock<std::mutex> lck(m_Mtx);
+        m_Cv.wait(lck, [this, key]() { return m_Seq.load(std::memory_order_relaxed) != key; });
+#endif
+        m_Waiters.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    //! Wake every waiting thread. Call it after publishing the change they wait for.
+    void notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!m_Waiters.load(std::memory_order_relaxed))
+            return;
+
+#ifdef __linux__
+        m_Seq.fetch_add(1, std::memory_order_release);
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&m_Seq), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#else
+        {
+            std::lock_guard<std::mutex> lck(m_Mtx);
+            m_Seq.fetch_add(1, std::memory_order_release);
+        }
+
+        m_Cv.notify_all();
+#endif
+    }
+
+private:
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "The futex word must be a plain 32 bit integer");
+
+    std::atomic<uint32_t> m_Seq;
+    std::atomic<uint32_t> m_Waiters;
+
+#ifndef __linux__
+    std::mutex m_Mtx;
+    std::condition_variable m_Cv;
+#endif
+};
+
+}
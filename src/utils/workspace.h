@@ -0,0 +1,115 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "aligned-ptr.h"
+#include "aligned-span.h"
+
+namespace util {
+
+/*! \brief Scratch Memory for a Single Processing Call
+ *
+ * A *workspace* hands out temporary arrays from memory owned by something else, e.g., the scratch
+ * buffer a *util::chain* keeps for each thread iterating over its links. Each *get()* carves the next
+ * array off the front, *ALIGNMENT* bytes apart, so every array has the alignment of the memory itself
+ * (e.g., the math library alignment of an *aligned_ptr*). *reset()* makes all of it available again.
+ * Nothing is allocated or freed, so a block which needs temporaries while processing takes them from
+ * here instead of keeping buffers of its own or allocating them on every call.
+ *
+ * A block declares how much it needs with *bytes()*, summed over its arrays; the total is what the
+ * workspace must hold. Components which need scratch (e.g., *comps::freq_est*) take a workspace so the
+ * block using them can pass its own down.
+ *
+ * \note The arrays are only valid until the next *reset()*; the contents aren't kept between calls.
+ */
+
+class workspace
+{
+public:
+
+    //! The granularity of the arrays, in bytes.
+    static constexpr size_t ALIGNMENT = 64;
+
+    //! Create an empty workspace.
+    workspace() : m_Base { nullptr }, m_Size { 0 }, m_Used { 0 } { }
+
+    //! Create a workspace over *mem*.
+    explicit workspace(aligned_span<uint8_t> mem) : m_Base { mem.data() }, m_Size { mem.size() }, m_Used { 0 } { }
+
+    //! Get the bytes an array of *n* samples takes in a workspace.
+    template<typename T>
+    static constexpr size_t bytes(const size_t n)
+    {
+        return (n * sizeof(T) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    //! Take an array of *n* samples. The contents are undefined.
+    template<typename T>
+    aligned_span<T> get(const size_t n)
+    {
+        const size_t b = bytes<T>(n);
+
+        assert((m_Used + b) <= m_Size);
+
+        T *ptr = reinterpret_cast<T*>(m_Base + m_Used);
+        m_Used += b;
+
+        return { ptr, n };
+    }
+
+    //! Make the whole workspace available again.
+    void reset() { m_Used = 0; }
+
+    //! Get the size of the workspace in bytes.
+    size_t size() const { return m_Size; }
+
+    //! Get the bytes taken since the last *reset()*.
+    size_t used() const { return m_Used; }
+
+private:
+
+    uint8_t *m_Base;
+    size_t m_Size;
+    size_t m_Used;
+};
+
+/*! \brief Memory Behind a Workspace
+ *
+ * Owns the memory of a *workspace* for code which isn't given one, e.g., a block which isn't run by a
+ * *util::chain*. The memory only grows, so once it has reached the size needed it's never allocated
+ * again.
+ */
+
+class scratch_buffer
+{
+public:
+
+    //! Get a workspace of at least *bytes*, emptied.
+    workspace& get(const size_t bytes)
+    {
+        if (m_Workspace.size() < bytes)
+        {
+            init_aligned_ptr_on_resize<uint8_t>(m_Mem, bytes);
+            m_Workspace = workspace(aligned_span<uint8_t> { m_Mem });
+        }
+
+        m_Workspace.reset();
+        return m_Workspace;
+    }
+
+    //! Size the memory up front.
+    void reserve(const size_t bytes) { get(bytes); }
+
+private:
+
+    aligned_ptr<uint8_t> m_Mem;
+    workspace m_Workspace;
+};
+
+}
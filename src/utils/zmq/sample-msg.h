@@ -11,6 +11,7 @@
 
 #include "context.h"
 #include "rm-math.h"
+#include "shared-block.h"
 
 namespace util { namespace zmq {
 
@@ -156,6 +157,49 @@ public:
         return rc;
     }
 
+    //! Send a shared block of samples to the subscriber without copying them. ZMQ holds a reference
+    //! to the block until the message has gone out.
+    //! @param [in] samples  The samples to send
+    //! @return Zero if successful, -1 otherwise. *errno* will contain the error code.
+    int send(const shared_block<T> &samples)
+    {
+        int rc = -1;
+        errno = EFAULT;
+
+        if (m_Sock)
+        {
+            zmq_msg_t msg;
+
+            rc = zmq_msg_init_size(&msg, m_MsgHdrLen);
+            checkMsg(rc, "zmq_msg_init_size", msg);
+
+            memcpy(zmq_msg_data(&msg), m_MsgHdr, m_MsgHdrLen);
+
+            rc = zmq_msg_send(&msg, m_Sock, ZMQ_SNDMORE);
+            checkMsg(rc, "zmq_msg_send", msg);
+
+            if (samples.empty())
+                rc = zmq_msg_init_size(&msg, 0);
+            else
+            {
+                void *ref = samples.ref();
+
+                rc = zmq_msg_init_data(&msg, const_cast<T*>(samples.data()), samples.size() * sizeof(T), freeBlock, ref);
+
+                // ZMQ only calls back for messages it initialized
+                if (rc == -1)
+                    shared_block<T>::unref(ref);
+            }
+
+            checkMsg(rc, "zmq_msg_init_data", msg);
+
+            rc = zmq_msg_send(&msg, m_Sock, 0);
+            checkMsg(rc,"zmq_msg_send", msg);
+        }
+
+        return rc;
+    }
+
     //! Receive a block of samples from the publisher.
     //! @param [out] samples  The received block of samples if successful; undefined otherwise.
     //! @param [in]  block    If *true* this will block until samples are received.
@@ -251,6 +295,12 @@ private:
     sock_t                            m_Sock;
 
     static constexpr char const *ep_str = "ipc:///tmp/radiomon_sock-";
+
+    // Called by ZMQ, possibly on its I/O thread, once a shared block has been sent
+    static void freeBlock(void *data, void *hint)
+    {
+        shared_block<T>::unref(hint);
+    }
 };
 
 }}
@@ -145,14 +145,35 @@ int main(int argc, char **argvp)
 
     if (!res)
     {
-        // main loop
-        while(running)
+        // Let the chain iterate on its own thread and watch the audio ring buffers. Set the cpu
+        // and priority parameters if xruns are a problem (see the bidirectional example above).
+        util::chain::run_params rp;
+
+        if (aep->input_buffer())
+            rp.watchSource(*aep->input_buffer());
+
+        if (aep->output_buffer())
+            rp.watchSink(*aep->output_buffer());
+
+        if (!chain.run(rp))
         {
-            chain.iterate();
+            printf("Chain run failed\n");
+            return -1;
+        }
 
-            // handle user input
+        // main loop - handle user input
+        while(running)
+        {
             menu.processInput();
+            util::timer::sleep(10);
         }
+
+        chain.stop();
+
+        util::chain::run_stats rs;
+        chain.getRunStats(rs);
+
+        printf("iterations=%lu overruns=%u underruns=%u\n", rs.iterations, rs.overruns, rs.underruns);
     }
     else
     {
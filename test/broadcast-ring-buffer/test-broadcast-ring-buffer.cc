@@ -0,0 +1,125 @@
+// Copyright (c) 2026 John Mark White -- US Amateur Radio License: W4KUS
+//
+// Licensed under the MIT License - see LICENSE file for details.
+
+#include <stdlib.h>
+#include <thread>
+#include <stdio.h>
+
+#include "timer.h"
+#include "cmdline.h"
+#include "broadcast-ring-buffer.h"
+
+static constexpr uint32_t BLOCK = 64;
+static constexpr uint32_t TOTAL = 1000000;
+
+// What a reader saw, see theReader().
+struct reader_result
+{
+    uint32_t torn;      // Blocks which don't count on within themselves
+    uint32_t skipped;   // Blocks which don't count on from the last
+    uint32_t resyncs;
+    uint64_t dropped;
+};
+
+// Read blocks of a counting sequence, sleeping *delayUs* after each, and check every block counts
+// on from the last. A dropping reader may skip ahead between blocks but never within one.
+void theReader(util::broadcast_ring_buffer<uint32_t> &rb, const int id, const uint32_t delayUs, const char *name,
+                reader_result &res)
+{
+    uint32_t buff[BLOCK];
+    uint32_t next = 0;
+    uint32_t errors = 0;
+    uint32_t torn = 0;
+    uint32_t blocks = 0;
+
+    while(next < TOTAL)
+    {
+        rb.read(id, buff, BLOCK);
+
+        if (rb.abortcode())
+            break;
+
+        if (buff[0] != next)
+        {
+            util::broadcast_ring_buffer<uint32_t>::diag d;
+            rb.diagnostics(id, d);
+
+            if (!d.resyncCount || (buff[0] < next))
+                ++errors;
+        }
+
+        for (size_t i=1;i < BLOCK;i++)
+            if (buff[i] != buff[0] + i)
+                ++torn;
+
+        next = buff[BLOCK - 1] + 1;
+        ++blocks;
+
+        if (delayUs)
+            util::timer::sleepUs(delayUs);
+    }
+
+    util::broadcast_ring_buffer<uint32_t>::diag d;
+    rb.diagnostics(id, d);
+
+    printf("%s: blocks=%u errors=%u torn=%u maxLag=%u ec=%u resyncs=%u dropped=%lu\n", name, blocks, errors,
+            torn, d.maxLag, d.emptyCount, d.resyncCount, static_cast<unsigned long>(d.dropped));
+
+    res.torn = torn;
+    res.skipped = errors;
+    res.resyncs = d.resyncCount;
+    res.dropped = d.dropped;
+
+    rb.detach(id);
+}
+
+int main(int argc, char **argvp)
+{
+    util::broadcast_ring_buffer<uint32_t> test(1024, 100);
+
+    // -e: block on events rather than sleeping for the yield time
+    if (util::cmdOptionExists(argvp, argvp + argc, "-e"))
+        test.setWaitMode(util::RB_WAIT_EVENT);
+
+    // Two blocking readers at different speeds and a slow one which drops
+    const int fast = test.addReader(util::SLOW_READER_BLOCK);
+    const int slow = test.addReader(util::SLOW_READER_BLOCK);
+    const int lossy = test.addReader(util::SLOW_READER_DROP);
+
+    reader_result fastRes {}, slowRes {}, lossyRes {};
+
+    std::thread th1(theReader, std::ref(test), fast, 0, "fast", std::ref(fastRes));
+    std::thread th2(theReader, std::ref(test), slow, 20, "slow", std::ref(slowRes));
+    std::thread th3(theReader, std::ref(test), lossy, 500, "lossy", std::ref(lossyRes));
+
+    uint32_t buff[BLOCK];
+
+    for (uint32_t i = 0;i < TOTAL;i += BLOCK)
+    {
+        for (uint32_t j = 0;j < BLOCK;j++)
+            buff[j] = i + j;
+
+        test.write(buff, BLOCK);
+    }
+
+    // The lossy reader may wait for data that never comes
+    th1.join();
+    th2.join();
+    test.abort();
+    th3.join();
+
+    printf("fc=%u\n", test.fullCount());
+
+    // The blocking readers must see every sample in order; the lossy one may skip between blocks.
+    for (auto *r : { &fastRes, &slowRes })
+    {
+        if (r->torn || r->skipped || r->resyncs || r->dropped)
+            return -1;
+    }
+
+    if (lossyRes.torn)
+        return -1;
+
+    return 0;
+}
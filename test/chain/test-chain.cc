@@ -5,8 +5,17 @@
 #include <stdlib.h>
 #include <thread>
 #include <stdio.h>
+#include <atomic>
+#include <algorithm>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
 
 #include "chain.h"
+#include "gain.h"
+#include "static-chain.h"
+#include "scheduler.h"
 #include "timer.h"
 #include "cmdline.h"
 
@@ -44,14 +53,160 @@ constexpr dsp::rate_t Fs = 48000;
 constexpr dsp::rate_t F = 800;
 constexpr size_t sampleNum = Fs / F * 48;
 constexpr int M = 4;
+constexpr uint32_t blockNum = 8;
 
 static FILE *f;
+static FILE *g;
+static FILE *h;
+static FILE *k;
+static FILE *r;
+static FILE *q;
+static FILE *b;
+static std::atomic<uint32_t> pipeCount;
+static uint32_t teeCount;
+static uint32_t runCount;
+static util::stop_source runStop;
+static std::atomic<uint32_t> schedCount;
+static uint64_t batchIndex;
+static uint32_t tagCount;
+static uint32_t tagErrors;
+static uint32_t rampNext;
+static uint32_t rampErrors;
+
+// A source which doesn't declare its block size (see dsp::block::getMaxSourceSize()) so a chain
+// can't plan for it. It outputs a ramp which carries on from block to block.
+class ramp_source : public dsp::block<dsp::func_ff>
+{
+public:
+    ramp_source(const size_t size) : dsp::block<dsp::func_ff> { dsp::TYPE_SOURCE }, m_Size { size }, m_Next { 0 }
+    {
+        process = std::bind(&ramp_source::generate, this, std::placeholders::_1, std::placeholders::_2);
+    }
+
+    void generate(const util::aligned_ptr<float> &inBlock, util::aligned_ptr<float> &outBlock)
+    {
+        m_SamplingRate = Fs;
+
+        util::init_aligned_ptr_on_resize<float>(outBlock, m_Size);
+
+        for (auto &s : outBlock)
+            s = static_cast<float>(m_Next++);
+    }
+
+private:
+    size_t m_Size;
+    uint32_t m_Next;
+};
 
 void chainCallback(const util::aligned_ptr<float> &buff)
 {
     util::printReal(f, buff.size(), buff.data());
 }
 
+void branchCallback(const util::aligned_ptr<float> &buff)
+{
+    util::printReal(h, buff.size(), buff.data());
+}
+
+void teeCallback(const util::aligned_ptr<float> &buff)
+{
+    // The main path after the tee sees the source block at the source rate.
+    teeCount += buff.size();
+}
+
+void staticCallback(const util::aligned_ptr<float> &buff)
+{
+    util::printReal(k, buff.size(), buff.data());
+}
+
+void rampCallback(const util::aligned_ptr<float> &buff)
+{
+    for (auto s : buff)
+    {
+        if (s != static_cast<float>(rampNext++))
+            rampErrors++;
+    }
+}
+
+void runCallback(const util::aligned_ptr<float> &buff)
+{
+    util::printReal(r, buff.size(), buff.data());
+
+    if (++runCount == blockNum)
+        runStop.request_stop();
+}
+
+// The first CPU the test may run on, e.g., under taskset or in a container without CPU 0, or -1 to
+// leave the run thread unpinned.
+int firstAllowedCpu()
+{
+#ifdef __linux__
+    cpu_set_t cpus;
+
+    if (!sched_getaffinity(0, sizeof(cpus), &cpus))
+    {
+        for (int i=0;i < CPU_SETSIZE;i++)
+        {
+            if (CPU_ISSET(i, &cpus))
+                return i;
+        }
+    }
+#endif
+    return -1;
+}
+
+void schedCallback(const util::aligned_ptr<float> &buff)
+{
+    // Only the first chain is checked; it keeps going until the scheduler is stopped.
+    if (schedCount < blockNum)
+        util::printReal(q, buff.size(), buff.data());
+
+    ++schedCount;
+}
+
+void schedOtherCallback(const util::aligned_ptr<float> &buff)
+{
+}
+
+// Holds up the other chains of its worker so they get stolen.
+void schedSlowCallback(const util::aligned_ptr<float> &buff)
+{
+    util::timer::sleepUs(2000);
+}
+
+// The delay of the resampler's filter in output samples; a tag shows up that much later.
+constexpr size_t tagDelay = ((lp_blackman_1p5k_48k_poly.size() * lp_blackman_1p5k_48k_poly[0].size() - 1) / 2 + M - 1) / M;
+
+void batchCallback(const util::aligned_ptr<float> &buff, const dsp::tag_list &tags)
+{
+    util::printReal(b, buff.size(), buff.data());
+
+    // Each source block of the batch is tagged with its sample index which the resampler
+    // scales down with the offset; the offset also moves by the filter delay.
+    for (auto &tag : tags)
+    {
+        if (tag.key != dsp::TAG_SAMPLE_INDEX)
+            continue;
+
+        if ((tag.index + tagDelay) != (batchIndex + tag.offset))
+            tagErrors++;
+
+        tagCount++;
+    }
+
+    batchIndex += buff.size();
+}
+
+void pipeCallback(const util::aligned_ptr<float> &buff)
+{
+    // Ignore anything arriving after the expected blocks while the pipeline winds down.
+    if (pipeCount < blockNum)
+    {
+        util::printReal(g, buff.size(), buff.data());
+        ++pipeCount;
+    }
+}
+
 int main(int argc, char **argvp)
 {
     util::chain theChain("TEST_CHAIN");
@@ -65,8 +220,12 @@ int main(int argc, char **argvp)
 
     f = fopen("test-chain.txt", "w");
 
+    // The gains are processed in place and cancel each other out.
+
     theChain.add(std::make_unique<dsp::endpoints::signal_source_ff>(sampleNum, F, Fs), "SIG_SOURCE");
     theChain.add(std::make_unique<dsp::rational_resampler_ff>(1, M, lp_blackman_1p5k_48k_poly), "RESAMPLER");
+    theChain.add(std::make_unique<dsp::gain_ff>(2.0f), "GAIN_UP");
+    theChain.add(std::make_unique<dsp::gain_ff>(0.5f), "GAIN_DOWN");
     theChain.add(std::make_unique<dsp::endpoints::callback_ff>(chainCallback), "CALLBACK");
 
     if (!theChain.setup())
@@ -75,9 +234,310 @@ int main(int argc, char **argvp)
         return -1;
     }
 
-    theChain.iterate();
+    for (uint32_t i=0;i < blockNum;i++)
+        theChain.iterate();
 
     fclose(f);
 
+    // The buffers are sized at setup so this should be zero.
+    printf("steady state allocations: %lu\n", theChain.steadyStateAllocs());
+
+    std::vector<util::chain::link_stats> stats;
+    theChain.stats(stats);
+
+    for (auto &s : stats)
+    {
+        printf("%s/%s: calls=%lu avg=%.0fns min=%luns max=%luns p50=%luns p99=%luns in=%lu out=%lu %.2fMSps\n",
+                s.chain, s.name,
+                s.prof.calls, s.prof.avgNs(), s.prof.minNs, s.prof.maxNs, s.prof.p50Ns, s.prof.p99Ns,
+                s.prof.samplesIn, s.prof.samplesOut, s.prof.msps());
+    }
+
+    // The same chain with each link running in its own pipeline stage. The output should match
+    // the serial chain above. Its buffers are in huge pages, or whatever the system falls back to.
+    util::chain pipeChain("PIPE_CHAIN");
+
+    pipeChain.setMemPolicy(util::MEM_HUGE_PAGES | util::MEM_NUMA_LOCAL);
+
+    g = fopen("test-chain-pipeline.txt", "w");
+
+    pipeChain.add(std::make_unique<dsp::endpoints::signal_source_ff>(sampleNum, F, Fs), "SIG_SOURCE");
+    pipeChain.add(std::make_unique<dsp::rational_resampler_ff>(1, M, lp_blackman_1p5k_48k_poly), "RESAMPLER");
+    pipeChain.add(std::make_unique<dsp::gain_ff>(2.0f), "GAIN_UP");
+    pipeChain.add(std::make_unique<dsp::gain_ff>(0.5f), "GAIN_DOWN");
+    pipeChain.add(std::make_unique<dsp::endpoints::callback_ff>(pipeCallback), "CALLBACK");
+
+    if (!pipeChain.setup() || !pipeChain.setStages({}))
+    {
+        printf("Pipeline setup failed\n");
+        return -1;
+    }
+
+    pipeChain.startPipeline();
+
+    while(pipeCount < blockNum)
+        util::timer::sleep(1);
+
+    pipeChain.stopPipeline();
+
+    printf("pipeline steady state allocations: %lu\n", pipeChain.steadyStateAllocs());
+
+    util::page_alloc_stats pages;
+    util::page_alloc::getStats(pages);
+
+    printf("pipeline buffers: %u huge TLB, %u transparent huge, %u small pages, %u too small, %u NUMA local, %u not bound, "
+            "%u moved to the consumer, %u not mapped\n", pages.hugeTlb, pages.transparent, pages.smallPages, pages.belowMin,
+            pages.numaLocal, pages.numaFailed, pages.numaConsumer, pages.unmapped);
+
+    // The latency from the source stamp to the end of each link, which includes the time each
+    // block waited between stages.
+    stats.clear();
+    pipeChain.stats(stats);
+
+    for (auto &s : stats)
+    {
+        printf("%s/%s: latency p50=%luns p99=%luns max=%luns\n", s.chain, s.name,
+                s.latency.p50Ns, s.latency.p99Ns, s.latency.maxNs);
+    }
+
+    std::vector<util::chain::latency_stats> latency;
+    pipeChain.latencyStats(latency);
+
+    for (auto &l : latency)
+    {
+        printf("%s: end-to-end latency calls=%lu p50=%luns p99=%luns max=%luns\n", l.chain,
+                l.latency.calls, l.latency.p50Ns, l.latency.p99Ns, l.latency.maxNs);
+    }
+
+    fclose(g);
+
+    // A fan-out chain where the resampler runs in a branch. The branch output should match the
+    // serial chain above while the main path carries on with the unresampled source blocks.
+    util::chain teeChain("TEE_CHAIN");
+    auto branch = std::make_unique<util::chain>("BRANCH");
+
+    h = fopen("test-chain-branch.txt", "w");
+
+    branch->add(std::make_unique<dsp::gain_ff>(2.0f), "GAIN_UP");
+    branch->add(std::make_unique<dsp::rational_resampler_ff>(1, M, lp_blackman_1p5k_48k_poly), "RESAMPLER");
+    branch->add(std::make_unique<dsp::gain_ff>(0.5f), "GAIN_DOWN");
+    branch->add(std::make_unique<dsp::endpoints::callback_ff>(branchCallback), "BRANCH_CALLBACK");
+
+    teeChain.add(std::make_unique<dsp::endpoints::signal_source_ff>(sampleNum, F, Fs), "SIG_SOURCE");
+    teeChain.add(std::move(branch), "TEE");
+    teeChain.add(std::make_unique<dsp::endpoints::callback_ff>(teeCallback), "CALLBACK");
+
+    if (!teeChain.setup())
+    {
+        printf("Tee chain setup failed\n");
+        return -1;
+    }
+
+    for (uint32_t i=0;i < blockNum;i++)
+        teeChain.iterate();
+
+    printf("tee main path: %u samples (expected %u)\n", teeCount, static_cast<uint32_t>(sampleNum * blockNum));
+    printf("tee steady state allocations: %lu\n", teeChain.steadyStateAllocs());
+
+    fclose(h);
+
+    // The serial chain again but built at compile time. The output should match.
+    dsp::endpoints::signal_source_ff staticSource { sampleNum, F, Fs };
+    dsp::rational_resampler_ff staticResampler { 1, M, lp_blackman_1p5k_48k_poly };
+    dsp::gain_ff staticGainUp { 2.0f };
+    dsp::gain_ff staticGainDown { 0.5f };
+    dsp::endpoints::callback_ff staticSink { staticCallback };
+
+    util::static_chain<dsp::endpoints::signal_source_ff, dsp::rational_resampler_ff,
+                        dsp::gain_ff, dsp::gain_ff, dsp::endpoints::callback_ff>
+        staticChain { staticSource, staticResampler, staticGainUp, staticGainDown, staticSink };
+
+    k = fopen("test-chain-static.txt", "w");
+
+    if (!staticChain.setup())
+    {
+        printf("Static chain setup failed\n");
+        return -1;
+    }
+
+    uint64_t staticAllocs = util::aligned_ptr_allocs();
+
+    for (uint32_t i=0;i < blockNum;i++)
+        staticChain.iterate();
+
+    fclose(k);
+
+    // The buffers and the scratch are sized at setup so this should be zero as well.
+    printf("static steady state allocations: %lu\n",
+            static_cast<unsigned long>(util::aligned_ptr_allocs() - staticAllocs));
+
+    // The serial chain again but iterated by the chain itself until the sink has seen all the
+    // blocks. The output should match.
+    util::chain runChain("RUN_CHAIN");
+
+    r = fopen("test-chain-run.txt", "w");
+
+    runChain.add(std::make_unique<dsp::endpoints::signal_source_ff>(sampleNum, F, Fs), "SIG_SOURCE");
+    runChain.add(std::make_unique<dsp::rational_resampler_ff>(1, M, lp_blackman_1p5k_48k_poly), "RESAMPLER");
+    runChain.add(std::make_unique<dsp::endpoints::callback_ff>(runCallback), "CALLBACK");
+
+    util::chain::run_params rp;
+    rp.cpu = firstAllowedCpu();
+
+    if (!runChain.setup() || !runChain.run(rp, runStop.get_token()))
+    {
+        printf("Run chain setup failed\n");
+        return -1;
+    }
+
+    while(runChain.isRunning())
+        util::timer::sleep(1);
+
+    runChain.stop();
+
+    util::chain::run_stats rs;
+    runChain.getRunStats(rs);
+    printf("run: %lu iterations (expected %u)\n", rs.iterations, blockNum);
+
+    fclose(r);
+
+    // The serial chain again, scheduled with three more chains on two workers. The output of the
+    // first chain should match and every chain should get its turn. The third chain is slow and
+    // shares a worker with the first, which the other worker should steal.
+    constexpr uint32_t schedChains = 4;
+    std::unique_ptr<util::chain> sched[schedChains];
+    util::scheduler theScheduler { 2 };
+
+    q = fopen("test-chain-sched.txt", "w");
+
+    for (uint32_t i=0;i < schedChains;i++)
+    {
+        sched[i] = std::make_unique<util::chain>("SCHED_CHAIN");
+        sched[i]->add(std::make_unique<dsp::endpoints::signal_source_ff>(sampleNum, F, Fs), "SIG_SOURCE");
+        sched[i]->add(std::make_unique<dsp::rational_resampler_ff>(1, M, lp_blackman_1p5k_48k_poly), "RESAMPLER");
+        sched[i]->add(std::make_unique<dsp::endpoints::callback_ff>(!i ? schedCallback :
+                        ((i == 2) ? schedSlowCallback : schedOtherCallback)), "CALLBACK");
+
+        if (!sched[i]->setup() || (theScheduler.add(*sched[i]) < 0))
+        {
+            printf("Scheduled chain setup failed\n");
+            return -1;
+        }
+    }
+
+    theScheduler.start();
+
+    std::vector<util::scheduler::chain_stats> ss;
+    bool allRan = false;
+
+    // Wait for every chain to run, or give up after about ten seconds.
+    for (uint32_t i=0;(i < 10000) && !allRan;i++)
+    {
+        util::timer::sleep(1);
+
+        ss.clear();
+        theScheduler.stats(ss);
+        allRan = std::all_of(ss.begin(), ss.end(), [](const util::scheduler::chain_stats &cs) {
+            return cs.iterations >= blockNum * 4;
+        });
+    }
+
+    theScheduler.stop();
+
+    ss.clear();
+    theScheduler.stats(ss);
+
+    uint64_t steals = 0;
+
+    for (auto &cs : ss)
+    {
+        steals += cs.steals;
+        printf("sched %s: %lu iterations, %lu steals, wait p50/p99 %lu/%lu ns, run p50/p99 %lu/%lu ns\n",
+                cs.name, cs.iterations, cs.steals, cs.wait.p50Ns, cs.wait.p99Ns, cs.run.p50Ns, cs.run.p99Ns);
+    }
+
+    printf("sched: every chain ran at least %u times: %s, %lu steals\n", blockNum * 4, allRan ? "yes" : "no",
+            static_cast<unsigned long>(steals));
+
+    fclose(q);
+
+    if (!allRan || !steals)
+        return -1;
+
+    // The serial chain again but gathering up to eight source blocks per iteration. The latency cap
+    // only lets four of them fit, so half the iterations. The output should match.
+    util::chain batchChain("BATCH_CHAIN");
+
+    b = fopen("test-chain-batch.txt", "w");
+
+    batchChain.add(std::make_unique<dsp::endpoints::signal_source_ff>(sampleNum, F, Fs), "SIG_SOURCE");
+    batchChain.add(std::make_unique<dsp::rational_resampler_ff>(1, M, lp_blackman_1p5k_48k_poly), "RESAMPLER");
+    batchChain.add(std::make_unique<dsp::endpoints::callback_ff>(batchCallback), "CALLBACK");
+    batchChain.setSourceTags(true);
+
+    if (!batchChain.setBatch(8, (sampleNum * 4 + sampleNum / 2) * 1000000ULL / Fs) || !batchChain.setup())
+    {
+        printf("Batch chain setup failed\n");
+        return -1;
+    }
+
+    for (uint32_t i=0;i < blockNum / 4;i++)
+        batchChain.iterate();
+
+    fclose(b);
+
+    printf("batch steady state allocations: %lu\n", batchChain.steadyStateAllocs());
+    printf("batch tags: %u sample index tags (expected %u), %u wrong\n", tagCount, blockNum, tagErrors);
+
+    // Rebuilt from scratch the chain starts a new stream so the sample indices start at zero again.
+    batchChain.clear();
+
+    b = fopen("test-chain-rebuilt.txt", "w");
+    batchIndex = 0;
+    tagCount = 0;
+    tagErrors = 0;
+
+    batchChain.add(std::make_unique<dsp::endpoints::signal_source_ff>(sampleNum, F, Fs), "SIG_SOURCE");
+    batchChain.add(std::make_unique<dsp::rational_resampler_ff>(1, M, lp_blackman_1p5k_48k_poly), "RESAMPLER");
+    batchChain.add(std::make_unique<dsp::endpoints::callback_ff>(batchCallback), "CALLBACK");
+    batchChain.setSourceTags(true);
+
+    if (!batchChain.setBatch(8, (sampleNum * 4 + sampleNum / 2) * 1000000ULL / Fs) || !batchChain.setup())
+    {
+        printf("Rebuilt chain setup failed\n");
+        return -1;
+    }
+
+    for (uint32_t i=0;i < blockNum / 4;i++)
+        batchChain.iterate();
+
+    fclose(b);
+
+    printf("rebuilt tags: %u sample index tags (expected %u), %u wrong\n", tagCount, blockNum, tagErrors);
+
+    if ((tagCount != blockNum) || tagErrors)
+        return -1;
+
+    // A batch from a source which didn't declare its block size grows while it's gathered; the
+    // blocks gathered before it grew must survive.
+    util::chain rampChain("RAMP_CHAIN");
+
+    rampChain.add(std::make_unique<ramp_source>(sampleNum), "RAMP_SOURCE");
+    rampChain.add(std::make_unique<dsp::endpoints::callback_ff>(rampCallback), "CALLBACK");
+
+    if (!rampChain.setBatch(4) || !rampChain.setup())
+    {
+        printf("Ramp chain setup failed\n");
+        return -1;
+    }
+
+    for (uint32_t i=0;i < blockNum / 4;i++)
+        rampChain.iterate();
+
+    printf("batch of undeclared size: %u samples (expected %lu), %u wrong\n", rampNext, blockNum * sampleNum, rampErrors);
+
+    if ((rampNext != blockNum * sampleNum) || rampErrors)
+        return -1;
+
     return 0;
 }
@@ -7,6 +7,7 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <cmath>
 
 #include "firfilt.h"
 #include "cmdline.h"
@@ -144,12 +145,14 @@ int main(int argc, char **argvp)
     FILE *f = fopen("ffilt-float.txt", "w");
 
     auto out = util::make_aligned_ptr<float>(64);
+    std::vector<float> floatOut;
 
     for (size_t i=0;i < 8;i++)
     {
         auto seg = util::make_aligned_ptr<float>(64, &test_sig[i * 64]);
         testFir.filter(seg, out);
         util::printReal(f, out.size(), out.data());
+        floatOut.insert(floatOut.end(), out.data(), out.data() + out.size());
     }
 
     fclose(f);
@@ -172,5 +175,50 @@ int main(int argc, char **argvp)
 
     fclose(f);
 
+    // Swap in the same taps doubled half way through. The delay line is carried over so the first
+    // half of the output should match the first run and the second half should be twice it.
+    f = fopen("ffilt-swap.txt", "w");
+
+    dsp::firfilter_ff swapFir { util::make_aligned_ptr<float>(tapNumLarge, lp_hamming_6k_large) };
+
+    std::vector<float> doubled(lp_hamming_6k_large, lp_hamming_6k_large + tapNumLarge);
+    std::vector<float> swapOut;
+
+    for (auto &t : doubled)
+        t *= 2.0f;
+
+    for (size_t i=0;i < 8;i++)
+    {
+        if (i == 4)
+            swapFir.setTaps(doubled);
+
+        auto seg = util::make_aligned_ptr<float>(64, &test_sig[i * 64]);
+        swapFir.filter(seg, out);
+        util::printReal(f, out.size(), out.data());
+        swapOut.insert(swapOut.end(), out.data(), out.data() + out.size());
+    }
+
+    fclose(f);
+
+    if (swapOut.size() != floatOut.size())
+    {
+        printf("Swapped output has %u samples, expected %u\n", static_cast<uint32_t>(swapOut.size()),
+                static_cast<uint32_t>(floatOut.size()));
+        return -1;
+    }
+
+    for (size_t i=0;i < swapOut.size();i++)
+    {
+        const float expected = (i < swapOut.size() / 2) ? floatOut[i] : 2.0f * floatOut[i];
+
+        if (std::fabs(swapOut[i] - expected) > 1e-6f)
+        {
+            printf("Swapped output differs at sample %u: %f != %f\n", static_cast<uint32_t>(i), swapOut[i], expected);
+            return -1;
+        }
+    }
+
+    printf("Swapped output matches\n");
+
     return 0;
 }
@@ -12,14 +12,20 @@
 
 static FILE *f, *g;
 static std::atomic_bool kill;
+static bool inPlace;
 
 void theThread(util::ring_buffer<uint32_t> &rb)
 {
-    uint32_t buff[4];
+    uint32_t copy[5];
 
     while(1)
     {
-        rb.read(buff, 5);
+        const uint32_t *buff = copy;
+
+        if (inPlace)
+            buff = rb.acquireRead(5).data();
+        else
+            rb.read(copy, 5);
 
         if (!rb.abortcode())
         {
@@ -27,6 +33,9 @@ void theThread(util::ring_buffer<uint32_t> &rb)
             for (size_t i=0;i < 5;i++)
                 fprintf(g, "%u ", buff[i]);
             fprintf(g, "\n");
+
+            if (inPlace)
+                rb.commitRead(5);
         }
         else
         {
@@ -38,7 +47,21 @@ void theThread(util::ring_buffer<uint32_t> &rb)
 
 int main(int argc, char **argvp)
 {
-    util::ring_buffer<uint32_t> test(8);
+    // -m: read in place from a buffer mapped twice; it must fill whole pages
+    inPlace = util::cmdOptionExists(argvp, argvp + argc, "-m");
+
+    util::ring_buffer<uint32_t> test(inPlace ? 1024 : 8, 1000, inPlace ? util::MEM_MIRRORED : util::MEM_DEFAULT);
+
+    printf("mirrored=%d\n", test.isMirrored());
+
+    // -o: overwrite the oldest samples rather than waiting when full; the reader loses data
+    if (util::cmdOptionExists(argvp, argvp + argc, "-o"))
+        test.setFullPolicy(util::RB_FULL_OVERWRITE_OLDEST);
+
+    // -e: block on events rather than sleeping for the yield time
+    if (util::cmdOptionExists(argvp, argvp + argc, "-e"))
+        test.setWaitMode(util::RB_WAIT_EVENT);
+
     std::thread th(theThread, std::ref(test));
 
     f = fopen("write.txt", "w");
@@ -57,7 +80,8 @@ int main(int argc, char **argvp)
         test.write(buff, 10);
     }
 
-    while(test.amount())
+    // Skipping overwritten samples can leave less than a read behind
+    while(test.amount() >= 5)
         util::timer::sleep(500);
 
     kill = true;
@@ -66,7 +90,18 @@ int main(int argc, char **argvp)
     util::ring_buffer<uint32_t>::diag diag;
     test.diagnostics(diag);
 
-    printf("fc=%u ec=%u\n", diag.fullCount, diag.emptyCount);
+    printf("fc=%u ec=%u dn=%lu ow=%lu\n", diag.fullCount, diag.emptyCount,
+            static_cast<unsigned long>(diag.droppedNewest), static_cast<unsigned long>(diag.overwritten));
+
+    util::ring_buffer_telemetry tel;
+    test.telemetry(tel);
+
+    printf("in=%lu out=%lu hw=%u/%u fill p50=%lu p99=%lu\n", static_cast<unsigned long>(tel.bytesIn),
+            static_cast<unsigned long>(tel.bytesOut), tel.highWater, tel.capacity,
+            static_cast<unsigned long>(tel.fillP50), static_cast<unsigned long>(tel.fillP99));
+    printf("producer waits=%lu p99=%luns consumer waits=%lu p99=%luns\n",
+            static_cast<unsigned long>(tel.producerWaits), static_cast<unsigned long>(tel.producerWaitP99Ns),
+            static_cast<unsigned long>(tel.consumerWaits), static_cast<unsigned long>(tel.consumerWaitP99Ns));
     fclose(f);
     fclose(g);
 
@@ -4,10 +4,13 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <cmath>
 
 #include "text-file-sink.h"
 #include "signal-source.h"
 #include "chain.h"
+#include "port.h"
+#include "shared-block.h"
 
 constexpr dsp::rate_t   Fs      = 48000;
 constexpr dsp::rate_t   F       = 800;
@@ -40,5 +43,26 @@ int main(int argc, char **argvp)
 
     chain.iterate();
 
-    return 0;
+    // One block held by a port and written by a file sink without being copied
+    util::aligned_ptr<float> samples { blkSz };
+
+    for (size_t i=0;i < blkSz;i++)
+        samples[i] = std::cos(2 * M_PI * F * i / Fs);
+
+    const float *buff = samples.data();
+    util::shared_block<float> blk { std::move(samples) };
+    util::port<float> port { 4 };
+    dsp::endpoints::text_file_sink_ff sink { "test-text-file-sink-shared.txt" };
+
+    port.produce(blk);
+    sink.write(blk);
+
+    util::shared_block<float> consumed;
+    port.consume(consumed);
+
+    const bool copied = (consumed.data() != buff) || (blk.data() != buff);
+
+    printf("shared block: %u references, %s\n", blk.useCount(), copied ? "COPIED" : "not copied");
+
+    return copied ? -1 : 0;
 }